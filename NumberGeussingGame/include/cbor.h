@@ -0,0 +1,51 @@
+#pragma once
+
+#include "json.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// CBOR (RFC 8949) encoding and decoding for the API, alongside the JSON and
+// MessagePack ones. Objects and streamed arrays are written with
+// indefinite-length framing, so nothing has to be counted up front.
+
+void appendCborString(std::string& out, std::string_view text);
+void appendCborInt(std::string& out, std::int64_t value);
+void appendCborDouble(std::string& out, double value);
+void appendCborBool(std::string& out, bool value);
+void appendCborNull(std::string& out);
+void appendCborArrayHeader(std::string& out, std::uint64_t count);
+
+// Indefinite-length map or array; close with appendCborBreak()
+void appendCborMapStart(std::string& out);
+void appendCborArrayStart(std::string& out);
+void appendCborBreak(std::string& out);
+
+// Pull reader over the members of a top-level map with text-string keys.
+// Definite and indefinite maps are accepted; strings are returned as views
+// into the input, so indefinite-length (chunked) strings are rejected. Tags
+// are ignored. Nested maps and arrays are skipped and returned as raw byte
+// views typed Object or Array. Nothing may follow the map.
+class CborReader {
+public:
+    explicit CborReader(std::string_view data) : data(data) {}
+
+    // Next member; false at the end of the map or on malformed input
+    bool next(JsonField& field);
+
+    // False if the input was not a well-formed map
+    bool ok() const { return !failed; }
+
+private:
+    std::string_view data;
+    std::size_t pos = 0;
+    std::uint64_t remaining = 0;
+    bool started = false;
+    bool indefinite = false;
+    bool finished = false;
+    bool failed = false;
+
+    bool fail() { failed = true; return false; }
+    bool finish();
+};
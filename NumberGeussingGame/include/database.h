@@ -1,7 +1,10 @@
 #pragma once
 
 #include <sqlite3.h>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Database {
@@ -16,9 +19,23 @@ public:
     bool createUser(const std::string& username, const std::string& password_hash);
     bool verifyUser(const std::string& username, const std::string& password_hash, int& user_id);
     bool userExists(const std::string& username);
+    int countUsers();
     
     // Game history operations
-    bool saveGame(int user_id, int target_number, int attempts, bool won);
+    bool saveGame(int user_id, std::int64_t target_number, int attempts, bool won,
+                  std::int64_t range_min, std::int64_t range_max);
+    
+    struct FinishedGame {
+        int user_id;
+        std::int64_t target_number;
+        int attempts;
+        bool won;
+        std::int64_t range_min;
+        std::int64_t range_max;
+    };
+    
+    // Save many games in one transaction; games of unknown users are skipped
+    bool saveGames(const std::vector<FinishedGame>& games);
     
     // Stats operations
     struct GameStats {
@@ -32,14 +49,19 @@ public:
     GameStats getUserStats(int user_id);
     
     // Leaderboard operations
+    // username views SQLite's column buffer and is only valid during the
+    // callback; copy it to keep it
     struct LeaderboardEntry {
-        std::string username;
+        std::string_view username;
         int best_score;
         int games_played;
         int wins;
     };
     
-    std::vector<LeaderboardEntry> getLeaderboard(int limit = 10);
+    // Hand each leaderboard row to callback as sqlite3_step produces it,
+    // so large leaderboards can be streamed without collecting them first.
+    // There is one row per user, so min(limit, countUsers()) rows arrive.
+    bool forEachLeaderboardEntry(int limit, const std::function<void(const LeaderboardEntry&)>& callback);
     
 private:
     sqlite3* db;
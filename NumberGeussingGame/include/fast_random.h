@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+    #include <intrin.h>
+#endif
+
+// Fast per-thread random numbers for game targets.
+//
+// Xoshiro256 is xoshiro256** (Blackman and Vigna): 32 bytes of state and a
+// few shifts and multiplies per 64-bit output. threadRandom() gives each
+// thread its own generator, seeded once from the OS, so picking a target
+// costs no syscall and no lock. Bounded values use Lemire's
+// multiply-and-reject method, which is unbiased and almost never divides.
+// Not for secrets: the output is predictable from enough samples, so
+// targets from wide ranges, which would show most of each output, are
+// drawn from the OS instead (see randomInRange).
+
+class Xoshiro256 {
+public:
+    // State expanded from one seed with splitmix64, as the authors recommend
+    explicit Xoshiro256(std::uint64_t seed);
+
+    // Seeded from std::random_device
+    static Xoshiro256 fromOs();
+
+    std::uint64_t next() {
+        std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+        std::uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+private:
+    std::uint64_t state[4];
+
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// The OS generator (std::random_device), for draws whose output must not
+// help predict later ones. Much slower than Xoshiro256.
+class OsRandom {
+public:
+    std::uint64_t next();
+};
+
+inline Xoshiro256& threadRandom() {
+    thread_local Xoshiro256 generator = Xoshiro256::fromOs();
+    return generator;
+}
+
+// High and low halves of a 64x64-bit product
+inline std::uint64_t multiplyFull(std::uint64_t a, std::uint64_t b, std::uint64_t& low) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    low = static_cast<std::uint64_t>(product);
+    return static_cast<std::uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    std::uint64_t high;
+    low = _umul128(a, b, &high);
+    return high;
+#else
+    std::uint64_t aLow = a & 0xFFFFFFFFu, aHigh = a >> 32;
+    std::uint64_t bLow = b & 0xFFFFFFFFu, bHigh = b >> 32;
+    std::uint64_t lowLow = aLow * bLow;
+    std::uint64_t middle = aHigh * bLow + (lowLow >> 32);
+    std::uint64_t cross = aLow * bHigh + (middle & 0xFFFFFFFFu);
+    low = (cross << 32) | (lowLow & 0xFFFFFFFFu);
+    return aHigh * bHigh + (middle >> 32) + (cross >> 32);
+#endif
+}
+
+// Uniform in [0, bound); bound must be non-zero. The high half of
+// random * bound is the result, and the rare low halves that would make some
+// results more likely than others are rejected.
+template <typename Generator>
+std::uint64_t boundedRandom(Generator& generator, std::uint64_t bound) {
+    std::uint64_t low;
+    std::uint64_t high = multiplyFull(generator.next(), bound, low);
+    if (low < bound) {
+        std::uint64_t threshold = (0 - bound) % bound;
+        while (low < threshold) {
+            high = multiplyFull(generator.next(), bound, low);
+        }
+    }
+    return high;
+}
+
+// Widest span drawn from threadRandom(); a target reveals at most about
+// this many bits of one generator output
+constexpr std::uint64_t kFastRandomMaxSpan = std::uint64_t(1) << 32;
+
+// Uniform in [min, max], inclusive; min must not exceed max. Spans wider
+// than kFastRandomMaxSpan come from OsRandom, so a revealed target never
+// hands out most of a generator output. The span of the full int64 range
+// wraps to 0 and takes a whole 64-bit OS value.
+inline std::int64_t randomInRange(std::int64_t min, std::int64_t max) {
+    std::uint64_t span = static_cast<std::uint64_t>(max) - static_cast<std::uint64_t>(min) + 1;
+    std::uint64_t offset;
+    if (span != 0 && span <= kFastRandomMaxSpan) {
+        offset = boundedRandom(threadRandom(), span);
+    } else {
+        OsRandom os;
+        offset = span == 0 ? os.next() : boundedRandom(os, span);
+    }
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(min) + offset);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "game_rules.h"
+#include "socket_compat.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Multiplayer rooms: many players guess one server-held number and follow
+// each other's progress over a Server-Sent Events stream.
+//
+// Members are connections that have been sent the event-stream head. The
+// member list is copy-on-write: join and drop build a new list and swap the
+// pointer in, so publish() reads a consistent snapshot without taking the
+// membership lock. Each event is framed once ("id:", "event:", "data:") and
+// the same bytes are written to every member. Sequence numbers are assigned
+// under a per-room publish lock, so every member sees a room's events in
+// the same order. Member sockets are non-blocking; a member that cannot take
+// a whole frame at once has fallen behind and is dropped, so one slow
+// client never stalls the rest.
+//
+// Every member gets a random token when it joins, sent only on its own
+// stream. Guesses are accepted only with the token of a current member and
+// count for the user that member joined as, so a guess cannot be made for
+// a player who is not in the room.
+
+struct RoomMember {
+    socket_t socket;
+    int userId;
+    std::uint64_t token;
+};
+
+class GameRoom {
+public:
+    static constexpr std::size_t kMaxMembers = 1000;
+
+    GameRoom(std::uint64_t id, DifficultyRange range);
+    ~GameRoom();
+
+    std::uint64_t id() const { return roomId; }
+    DifficultyRange range() const { return roomRange; }
+
+    // Take over a connection that has already received the stream head and
+    // return the new member's token. A user joining again replaces their
+    // previous connection. Returns 0, and closes the connection, if the
+    // room already has kMaxMembers members.
+    std::uint64_t join(socket_t socket, int userId);
+    std::size_t memberCount() const;
+
+    struct GuessOutcome {
+        int userId;                 // The member who guessed
+        Clue clue;
+        bool higher;                // The target is above the guess
+        std::uint32_t round;        // Round the guess was counted in
+        std::uint32_t attempts;     // The player's attempts this round
+        std::int64_t target;        // Only meaningful when clue is Correct
+    };
+
+    // Count a member's guess against the current round; a correct one
+    // starts the next. False if token is not a current member's.
+    bool guess(std::uint64_t token, std::int64_t value, GuessOutcome& outcome);
+
+    std::uint32_t round() const;
+
+    // Frame data as event name with the next sequence number and write it to
+    // every member. Returns the sequence number.
+    std::uint64_t publish(std::string_view event, std::string_view data);
+
+    // Frame data as event name, without a sequence number, and write it to
+    // the member with this token only. False if it is not a member.
+    bool sendTo(std::uint64_t token, std::string_view event, std::string_view data);
+
+    // Comment frame that keeps idle streams open and finds closed ones
+    void heartbeat();
+
+    std::time_t lastActive() const;
+
+private:
+    using Members = std::vector<RoomMember>;
+
+    const std::uint64_t roomId;
+    const DifficultyRange roomRange;
+
+    std::shared_ptr<const Members> members;     // Replaced, never modified
+    std::mutex membershipMutex;                 // Serializes replacements
+
+    std::mutex publishMutex;
+    std::uint64_t nextSequence = 1;
+    std::string frame;                          // Reused under publishMutex
+
+    mutable std::mutex roundMutex;
+    std::int64_t target;
+    std::uint32_t roundNumber = 1;
+    std::unordered_map<int, std::uint32_t> attemptsByUser;
+    std::time_t active;
+
+    // Write frame to every member in the snapshot, then drop failed ones
+    void fanOut(std::string_view bytes);
+    void appendFrame(std::string_view event, std::string_view data);
+    void drop(const std::vector<socket_t>& sockets);
+};
+
+// Rooms by ID. IDs are 64-bit values from the OS generator, sent as 16 hex
+// digits, so one room's ID says nothing about another's.
+//
+// Every member holds a socket for as long as it stays, so the streams of all
+// rooms together are capped below the process's descriptor limit, leaving
+// kDescriptorHeadroom for requests, the database and the listener.
+class RoomRegistry {
+public:
+    static constexpr std::time_t kEmptyRoomSeconds = 10 * 60;
+    static constexpr std::size_t kMaxRooms = 1000;
+    static constexpr std::size_t kDescriptorHeadroom = 64;
+
+    RoomRegistry() : streamLimit(streamLimitFromDescriptors()) {}
+
+    // RLIMIT_NOFILE less the headroom
+    static std::size_t streamLimitFromDescriptors();
+
+    std::size_t maxStreams() const { return streamLimit; }
+
+    // False once the rooms hold maxStreams() streams between them
+    bool acceptsStream();
+
+    // Nullptr if kMaxRooms rooms already exist
+    std::shared_ptr<GameRoom> create(DifficultyRange range);
+    std::shared_ptr<GameRoom> find(std::uint64_t id);
+
+    // Heartbeat every room and forget rooms left empty for kEmptyRoomSeconds
+    void heartbeat();
+
+    std::size_t size();
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::uint64_t, std::shared_ptr<GameRoom>> rooms;
+    const std::size_t streamLimit;
+};
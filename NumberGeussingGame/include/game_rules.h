@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Difficulty ranges and the hot/cold clue given for each guess.
+//
+// A clue band depends on the distance from the target as a share of the
+// range: within 5% is very hot, 10% hot, 20% warm, 40% cool, anything
+// further cold. The shares are compared in integers, and the built-in
+// difficulties look the band up in a table indexed by distance, precomputed
+// at compile time. Custom ranges may span all 64-bit values; distances and
+// spans are then taken as unsigned and the thresholds are computed so that
+// nothing overflows.
+
+struct DifficultyRange {
+    std::int64_t min;
+    std::int64_t max;
+};
+
+constexpr DifficultyRange kEasyRange{1, 50};
+constexpr DifficultyRange kMediumRange{1, 100};
+constexpr DifficultyRange kHardRange{1, 200};
+
+struct DifficultyProfile {
+    std::string_view name;
+    DifficultyRange range;
+};
+
+// Named difficulties accepted by /api/new-game besides "custom"
+constexpr DifficultyProfile kDifficultyProfiles[] = {
+    {"easy", kEasyRange},
+    {"medium", kMediumRange},
+    {"hard", kHardRange},
+};
+
+// Distance between two values, exact over the whole int64 range
+constexpr std::uint64_t distanceBetween(std::int64_t a, std::int64_t b) {
+    return a < b ? static_cast<std::uint64_t>(b) - static_cast<std::uint64_t>(a)
+                 : static_cast<std::uint64_t>(a) - static_cast<std::uint64_t>(b);
+}
+
+enum class Clue : std::uint8_t {
+    Correct,
+    VeryHot,
+    Hot,
+    Warm,
+    Cool,
+    Cold
+};
+
+constexpr int kClueCount = 6;
+
+// Band edges as percentages of the range, ascending and at most 100:
+// a miss within percent[0] is very hot, within percent[1] hot, and so on
+struct ClueThresholds {
+    std::uint32_t percent[4];
+};
+
+constexpr ClueThresholds kDefaultClueThresholds{{5, 10, 20, 40}};
+
+// floor(range * percent / 100) without forming range * percent
+constexpr std::uint64_t bandLimit(std::uint64_t range, std::uint64_t percent) {
+    return (range / 100) * percent + (range % 100) * percent / 100;
+}
+
+// Largest distance in each band for one range
+struct ClueLimits {
+    std::uint64_t limit[4];
+
+    constexpr ClueLimits(std::uint64_t range, const ClueThresholds& thresholds)
+        : limit{bandLimit(range, thresholds.percent[0]), bandLimit(range, thresholds.percent[1]),
+                bandLimit(range, thresholds.percent[2]), bandLimit(range, thresholds.percent[3])} {}
+
+    // diff * 100 <= range * percent is tested as diff <= limit
+    constexpr Clue classify(std::uint64_t diff) const {
+        if (diff == 0) return Clue::Correct;
+        if (diff <= limit[0]) return Clue::VeryHot;
+        if (diff <= limit[1]) return Clue::Hot;
+        if (diff <= limit[2]) return Clue::Warm;
+        if (diff <= limit[3]) return Clue::Cool;
+        return Clue::Cold;
+    }
+};
+
+// Band for a distance without a table; range 0 makes every miss cold
+constexpr Clue classifyDistance(std::uint64_t diff, std::uint64_t range,
+                                const ClueThresholds& thresholds = kDefaultClueThresholds) {
+    return ClueLimits(range, thresholds).classify(diff);
+}
+
+// classify() over a batch of distances. Branch-free, so the compiler can
+// vectorize it; used by the simulator to step many games at once.
+void classifyDistances(const ClueLimits& limits, const std::uint64_t* diffs, std::size_t count, Clue* clues);
+
+Clue classifyGuess(std::int64_t guess, std::int64_t target, std::int64_t min, std::int64_t max);
+
+// "Very hot! The number is higher." and so on; "Correct!" ignores higher
+std::string_view clueMessage(Clue clue, bool higher);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// State of one game in progress, owned by the server so clients cannot
+// choose their own target, range or attempt count
+struct GameSession {
+    int userId = 0;
+    std::int64_t target = 0;
+    std::int64_t min = 1;
+    std::int64_t max = 100;
+    int attempts = 0;
+    std::time_t started = 0;
+    std::time_t lastActive = 0;
+};
+
+// Game IDs travel as 16 hex digits; JavaScript numbers cannot hold 64 bits
+constexpr std::size_t kGameIdLength = 16;
+
+// Writes exactly kGameIdLength characters to buffer and returns them
+std::string_view formatGameId(std::uint64_t id, char* buffer);
+bool parseGameId(std::string_view text, std::uint64_t& id);
+
+// Compact record for one game slot. Times are seconds since the store was
+// created. The generation is odd while the slot holds a game and even while
+// it is free, so a stale timing-wheel entry never matches. The tag is drawn
+// from the OS generator for each game and must match the one in its ID.
+struct GameRecord {
+    std::uint32_t generation;
+    union {
+        std::int32_t userId;
+        std::uint32_t nextFree;     // Free-list link while the slot is unused
+    };
+    std::uint32_t attempts;
+    std::uint32_t tag;
+    std::uint32_t started;
+    std::uint32_t lastActive;
+    std::int64_t target;
+    std::int64_t min;
+    std::int64_t max;
+};
+
+static_assert(sizeof(GameRecord) == 48, "GameRecord should stay small");
+
+// In-memory table of games in progress.
+//
+// Records live in fixed-size slab pages that are never moved or returned,
+// and freed slots are reused through an intrusive free list. A game is
+// addressed by a handle of (tag << 32 | slot index), where the tag is 32
+// random bits kept in the record; the public ID is that handle run through a
+// keyed bijective mix. The mix only keeps IDs opaque: the tag is what stops
+// a player who has worked out the slot layout from reaching another
+// player's game, since it has to be guessed for each game. A lookup is an
+// unmix, an array index and a tag compare, with no hashing. Slots are spread
+// over kShardCount independently locked slabs so concurrent requests rarely
+// share a lock.
+//
+// Games idle for longer than the idle timeout are reclaimed by expire(),
+// driven from the server loop. Each shard keeps a timing wheel of
+// kWheelSlots buckets of handles, bucketed by idle deadline; a tick only
+// visits the bucket that came due. Guesses just refresh lastActive, and a
+// game that turns out to have been active since is moved to its new bucket.
+//
+// On a hot upgrade the old process writes a snapshot of the slabs, the ID
+// keys and the epoch, and the new process restores it before it serves, so
+// games carry on with the same IDs.
+class GameSessionStore {
+public:
+    static constexpr std::uint32_t kShardCount = 16;
+    static constexpr std::uint32_t kPageRecords = 1024;
+    static constexpr std::uint32_t kWheelSlots = 64;
+    static constexpr std::uint32_t kDefaultIdleSeconds = 30 * 60;
+
+    explicit GameSessionStore(std::uint32_t idleSeconds = kDefaultIdleSeconds);
+
+    // NGG_GAME_IDLE_SECONDS, or kDefaultIdleSeconds
+    static std::uint32_t idleTimeoutFromEnvironment();
+
+    std::uint32_t idleTimeout() const { return idleSeconds; }
+
+    // Start a game and return its ID
+    std::uint64_t create(int userId, std::int64_t target, std::int64_t min, std::int64_t max);
+
+    // Count a guess against the game and copy out its updated state.
+    // A correct guess ends the game. False if there is no such game.
+    bool guess(std::uint64_t id, std::int64_t guess, GameSession& session);
+
+    // End the game early and copy out its final state; false if unknown
+    bool end(std::uint64_t id, GameSession& session);
+
+    // End every game idle for the timeout or longer, appending its final
+    // state to expired. Returns how many games were ended.
+    std::size_t expire(std::vector<GameSession>& expired);
+
+    // Append every game in progress and the ID keys to out, in this
+    // machine's byte order, for restore() in the process taking over
+    void snapshot(std::string& out) const;
+
+    // Take over the games in a snapshot; call on an empty store before it is
+    // used. False, leaving the store empty, if the snapshot was written by a
+    // build with a different record layout or is malformed.
+    bool restore(std::string_view data);
+
+    // Games in progress
+    std::size_t size() const;
+
+    // Bytes held by slab pages, live or free
+    std::size_t reservedBytes() const;
+
+private:
+    static constexpr std::uint32_t kNoSlot = 0xFFFFFFFFu;
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<GameRecord[]>> pages;
+        std::uint32_t slots = 0;        // Slots handed out so far, live or free
+        std::uint32_t freeHead = kNoSlot;
+        std::uint32_t live = 0;
+        std::vector<std::uint64_t> wheel[kWheelSlots];  // generation << 32 | slot
+        std::vector<std::uint64_t> due;                 // Bucket being swept
+        std::uint32_t nextTick = 0;
+    };
+
+    Shard shards[kShardCount];
+    std::uint32_t idleSeconds;
+    std::uint32_t tickSeconds;
+    std::atomic<std::uint32_t> nextShard{0};
+    std::uint64_t idKeys[2];
+    std::time_t epoch;
+
+    std::uint64_t toId(std::uint64_t handle) const;
+    std::uint64_t toHandle(std::uint64_t id) const;
+    std::uint32_t now() const;
+
+    // Live record for a timing-wheel entry or for an ID's tag, or nullptr;
+    // caller holds the shard lock
+    static GameRecord* find(Shard& shard, std::uint32_t slot, std::uint32_t generation);
+    static GameRecord* findTagged(Shard& shard, std::uint32_t slot, std::uint32_t tag);
+    static void release(Shard& shard, std::uint32_t slot, GameRecord& record);
+    void schedule(Shard& shard, std::uint32_t slot, const GameRecord& record) const;
+    void copyOut(const GameRecord& record, GameSession& session) const;
+};
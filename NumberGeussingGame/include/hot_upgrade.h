@@ -0,0 +1,54 @@
+#pragma once
+
+#include "socket_compat.h"
+#include <string>
+#include <string_view>
+
+// Zero-downtime binary upgrade, nginx style.
+//
+// Sending SIGUSR2 to a running server makes it exec a fresh copy of its own
+// binary and hand the listening socket to it over a Unix socket (SCM_RIGHTS).
+// The old process keeps serving while the new one starts up. Once the new
+// one reports ready, the old process stops accepting, sends its state (the
+// games in progress) over the same channel and exits; the new process
+// restores that state before it accepts anything. Connections that arrive
+// in between wait in the kernel backlog, so the port never closes.
+//
+// On Windows every call is a no-op and upgrades are never requested.
+class HotUpgrade {
+public:
+    // Install the SIGUSR2 handler and ignore SIGPIPE
+    static void installSignalHandlers();
+
+    // Remember the absolute path of this binary for the upgrade to exec.
+    // Call at startup: argv[0] may be relative or a bare name found on PATH.
+    static void resolveExecutable(const char* argv0);
+
+    // True once SIGUSR2 has been received and not yet handled
+    static bool requested();
+
+    // Receive the listening socket from the previous process if this process
+    // was started by an upgrade; returns INVALID_SOCKET otherwise
+    static socket_t receiveListener();
+
+    // Tell the previous process we are ready to take over and wait for the
+    // state it hands over. False, with state empty, if this process was not
+    // started by an upgrade or no state arrived within the timeout.
+    static bool confirmReady(std::string& state);
+
+    // Start the new binary and pass it the listener. Returns at once; this
+    // process keeps serving until handOffComplete() says otherwise.
+    static bool beginHandOff(socket_t listener, char* argv[]);
+
+    // Channel the new binary reports ready on, for the server loop to poll;
+    // INVALID_SOCKET when no upgrade is in progress
+    static socket_t handOffChannel();
+
+    // True once the new binary is ready and this process should stop.
+    // An upgrade that is not ready within the timeout is abandoned and the
+    // new process killed.
+    static bool handOffComplete();
+
+    // After handOffComplete(), send state to the new binary and close the channel
+    static bool sendState(std::string_view state);
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Headers the server looks at, resolved to fixed slots while parsing
+enum class KnownHeader {
+    ContentLength,
+    Connection,
+    AcceptEncoding,
+    IfNoneMatch,
+    TransferEncoding,
+    Accept,
+    ContentType,
+    Count
+};
+
+// Small inline header table with case-insensitive lookup.
+// Known headers are also stored in direct slots, so reading them is O(1).
+// The first kCapacity headers live inline; any more, which only a raised
+// NGG_MAX_HEADER_COUNT lets through, spill into a heap-allocated overflow.
+class HeaderTable {
+public:
+    static constexpr std::size_t kCapacity = 32;
+
+    void clear();
+
+    void add(std::string_view name, std::string_view value);
+
+    // Value of the named header, or an empty view if it is missing
+    std::string_view get(std::string_view name) const;
+    bool has(std::string_view name) const;
+
+    std::string_view get(KnownHeader header) const {
+        return known[static_cast<std::size_t>(header)];
+    }
+    bool has(KnownHeader header) const {
+        return known[static_cast<std::size_t>(header)].data() != nullptr;
+    }
+
+    std::size_t size() const { return count + overflow.size(); }
+    const HttpHeader& operator[](std::size_t i) const {
+        return i < count ? entries[i] : overflow[i - count];
+    }
+
+private:
+    HttpHeader entries[kCapacity];
+    std::size_t count = 0;
+    std::vector<HttpHeader> overflow;
+    std::string_view known[static_cast<std::size_t>(KnownHeader::Count)];
+};
+
+// ASCII case-insensitive comparison for header names and tokens
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+// Outcome of looking up a query parameter. TooLong means the escaped value
+// did not fit in the request's scratch buffer; the request should be
+// rejected rather than treated as if the parameter were absent.
+enum class QueryResult {
+    Found,
+    Missing,
+    Invalid,    // queryInt only: present but not a number
+    TooLong
+};
+
+// Structure to hold HTTP request data.
+// Every field is a view into the receive buffer passed to parseHttpRequest,
+// so the buffer must outlive the request. Nothing is allocated on the heap
+// unless a request has more than HeaderTable::kCapacity headers.
+struct HttpRequest {
+    static constexpr std::size_t kScratchSize = 512;
+
+    std::string_view method;
+    std::string_view path;
+    std::string_view query;     // Raw query string without the leading '?'
+    std::string_view body;
+    HeaderTable headers;
+
+    // While Incomplete: total bytes the request needs, or 0 if not yet known
+    std::size_t expectedSize = 0;
+
+    // Percent-decoded value of a query parameter.
+    // Values without escapes are returned as views into the request; escaped
+    // ones are decoded into the request's scratch buffer, which lives as long
+    // as the request. Keys are compared after decoding.
+    QueryResult queryParam(std::string_view key, std::string_view& value) const;
+
+    // Integer query parameter; value is only set when Found
+    QueryResult queryInt(std::string_view key, int& value) const;
+
+    // Reset per-request state before reusing the object
+    void reset() { scratchUsed = 0; }
+
+private:
+    mutable char scratch[kScratchSize];
+    mutable std::size_t scratchUsed = 0;
+};
+
+// Parse a whole decimal integer without exceptions or allocation
+template <typename T>
+bool parseInteger(std::string_view text, T& value) {
+    // One optional sign: from_chars would still take a '-' after the '+'
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+        if (!text.empty() && text.front() == '-') {
+            return false;
+        }
+    }
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+// Hard caps on what a client can make the server buffer.
+// Configured from the environment:
+//   NGG_MAX_HEADER_BYTES     request line plus headers (default 8 KB)
+//   NGG_MAX_HEADER_COUNT     number of headers (default HeaderTable::kCapacity)
+//   NGG_MAX_BODY_BYTES       decoded body (default 64 KB)
+//   NGG_REQUEST_BUFFER_BUDGET  bytes all request buffers may hold at once (default 64 MB)
+//   NGG_REQUEST_TIMEOUT_MS   time allowed to receive a whole request (default 2000)
+struct HttpLimits {
+    std::size_t maxHeaderBytes = 8 * 1024;
+    std::size_t maxHeaderCount = HeaderTable::kCapacity;
+    std::size_t maxBodyBytes = 64 * 1024;
+    std::size_t bufferBudgetBytes = 64 * 1024 * 1024;
+    std::size_t requestTimeoutMillis = 2000;
+
+    static HttpLimits fromEnvironment();
+
+    // Largest raw request worth buffering, allowing for chunk framing
+    std::size_t maxRequestBytes() const { return maxHeaderBytes + 2 * maxBodyBytes + 1024; }
+};
+
+// Receive buffer for one request.
+// Small requests fit in inline storage; larger ones grow on the heap up to
+// the configured caps, drawing on a budget shared by the whole process.
+class RequestBuffer {
+public:
+    static constexpr std::size_t kInlineSize = 4096;
+
+    explicit RequestBuffer(const HttpLimits& limits);
+    ~RequestBuffer();
+    RequestBuffer(const RequestBuffer&) = delete;
+    RequestBuffer& operator=(const RequestBuffer&) = delete;
+
+    char* data() { return heap ? heap : inlineStorage; }
+    std::size_t size() const { return used; }
+    std::size_t capacity() const { return heap ? heapCapacity : kInlineSize; }
+
+    // Free space to recv() into, then commit() what arrived
+    char* tail() { return data() + used; }
+    std::size_t space() const { return capacity() - used; }
+    void commit(std::size_t bytes) { used += bytes; }
+
+    enum class GrowResult { Ok, TooLarge, OverBudget };
+    GrowResult grow(std::size_t wanted);
+
+    // Bytes currently charged against the process-wide budget
+    static std::size_t budgetInUse();
+
+private:
+    const HttpLimits& limits;
+    char inlineStorage[kInlineSize];
+    char* heap = nullptr;
+    std::size_t heapCapacity = 0;
+    std::size_t used = 0;
+};
+
+enum class ParseResult {
+    Ok,
+    Incomplete,         // Need more bytes: headers not terminated or body short
+    Invalid,            // 400
+    HeadersTooLarge,    // 431
+    BodyTooLarge        // 413
+};
+
+// Parse an HTTP request in place over the receive buffer, enforcing limits.
+// A chunked request body is decoded in place once all of it has arrived,
+// so the buffer is modified after the headers; call again with the same
+// data only while the result is Incomplete.
+ParseResult parseHttpRequest(char* data, std::size_t size, HttpRequest& request, const HttpLimits& limits);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "socket_compat.h"
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+enum class ContentKind {
+    Json,
+    Html,
+    Css,
+    MessagePack,
+    Cbor
+};
+
+// Encoding of API bodies, negotiated per request (see wire_format.h)
+enum class WireFormat {
+    Json,
+    MessagePack,
+    Cbor
+};
+
+// Cached "Date: ...\r\n" header line.
+// The server loop calls refresh() about once a second; responses copy the
+// cached bytes instead of formatting the time themselves.
+class HttpDate {
+public:
+    // Reformat the line if the wall-clock second changed
+    static void refresh(std::time_t now = std::time(nullptr));
+
+    static std::string_view line();
+};
+
+// Write a complete 200 response into out, replacing its contents.
+// The status line and fixed headers come from a prebuilt block per content
+// kind; only the Date line, Content-Length digits and body are copied in.
+void writeResponse(std::string& out, ContentKind kind, std::string_view body);
+
+// Errors with static bodies, in the order of the prebuilt table
+enum class HttpError {
+    BadRequest,
+    NotFound,
+    RequestTimeout,
+    PayloadTooLarge,
+    HeaderFieldsTooLarge,
+    ServiceUnavailable
+};
+
+void writeError(std::string& out, HttpError error);
+
+// Response for one connection.
+// Fixed-size responses are built in the buffer and sent by finish().
+// beginBody() lets a handler write the body in place: room for the headers
+// is reserved at the front of the buffer and endBody() fills it in once the
+// length is known, so the body is never copied.
+// Streamed responses use chunked transfer encoding: handlers append to
+// chunkBuffer() and call flushIfFull(), so at most about kChunkSize bytes
+// are held in memory however large the body gets.
+class HttpResponse {
+public:
+    static constexpr std::size_t kChunkSize = 16 * 1024;
+
+    // buffer is reused across requests to avoid reallocating
+    HttpResponse(socket_t socket, std::string& buffer);
+
+    void send(ContentKind kind, std::string_view body);
+    void error(HttpError error);
+    void notFound() { error(HttpError::NotFound); }
+
+    // Append the body to the returned buffer, then call endBody()
+    std::string& beginBody(ContentKind kind);
+    void endBody();
+
+    // API bodies use the format the client negotiated; JSON by default
+    void setFormat(WireFormat wireFormat) { negotiated = wireFormat; }
+    WireFormat format() const { return negotiated; }
+    ContentKind formatKind() const;
+    std::string& beginBody() { return beginBody(formatKind()); }
+
+    // Start a chunked response; headers go out with the first chunk
+    void beginChunked(ContentKind kind);
+    std::string& chunkBuffer() { return buffer; }
+    void write(std::string_view data);
+    void flushIfFull();
+    void endChunked();
+
+    // True once bytes have been written to the socket
+    bool started() const { return bytesSent > 0; }
+
+    // Send a text/event-stream head now and hand the socket to the caller,
+    // which keeps it open for Server-Sent Events. finish() then sends nothing
+    // and the server loop leaves the socket open.
+    bool startEventStream();
+    bool handedOff() const { return eventStream; }
+    socket_t connection() const { return socket; }
+
+    // Send the buffered response (or the tail of a chunked one)
+    bool finish();
+
+private:
+    socket_t socket;
+    std::string& buffer;
+    std::size_t chunkStart = 0;     // Offset of the open chunk's size field
+    std::size_t bytesSent = 0;
+    std::size_t sendOffset = 0;     // Start of the headers written by endBody()
+    ContentKind bodyKind = ContentKind::Json;
+    WireFormat negotiated = WireFormat::Json;
+    bool chunked = false;
+    bool eventStream = false;
+    bool failed = false;
+
+    void openChunk();
+    void closeChunk();
+    bool sendBuffer();
+};
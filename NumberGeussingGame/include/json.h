@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class JsonType {
+    String,
+    Number,
+    Boolean,
+    Null,
+    Object,
+    Array
+};
+
+// View of one value inside a JSON document.
+// Nothing is decoded up front: strings keep their raw (escaped) text and
+// numbers their source digits until a handler asks for them.
+class JsonValue {
+public:
+    JsonValue() = default;
+    JsonValue(JsonType type, std::string_view raw, bool escaped)
+        : valueType(type), text(raw), hasEscapes(escaped) {}
+
+    // Numbers that a binary reader (MessagePack, CBOR) already decoded
+    static JsonValue fromInteger(std::int64_t value);
+    static JsonValue fromReal(double value);
+
+    JsonType type() const { return valueType; }
+
+    // Source text; for strings, the contents between the quotes. Empty for
+    // numbers made by fromInteger/fromReal.
+    std::string_view raw() const { return text; }
+
+    // Typed accessors return false on a type mismatch or out-of-range value.
+    // Numeric strings are accepted where a number is expected.
+    bool asInt(int& out) const;
+    bool asInt64(std::int64_t& out) const;
+    bool asDouble(double& out) const;
+    bool asBool(bool& out) const;
+
+    // Decode the string, resolving escapes; out is only grown, never read
+    bool asString(std::string& out) const;
+
+    // Compare the decoded string to plain without allocating
+    bool equals(std::string_view plain) const;
+
+private:
+    enum class NumberForm : unsigned char {
+        Text,
+        Integer,
+        Real
+    };
+
+    JsonType valueType = JsonType::Null;
+    std::string_view text;
+    bool hasEscapes = false;
+    NumberForm form = NumberForm::Text;
+    std::int64_t integer = 0;
+    double real = 0.0;
+};
+
+struct JsonField {
+    std::string_view key;       // Raw key text between the quotes
+    bool keyEscaped = false;
+    JsonValue value;
+
+    bool keyEquals(std::string_view plain) const;
+};
+
+// Single-pass pull reader over the members of a top-level JSON object.
+// Works directly on the input; nested objects and arrays are checked
+// against the JSON grammar and returned as raw views. Nothing but
+// whitespace may follow the object.
+class JsonReader {
+public:
+    explicit JsonReader(std::string_view json) : json(json) {}
+
+    // Next member; false at the end of the object or on malformed input
+    bool next(JsonField& field);
+
+    // False if the input was not a well-formed object
+    bool ok() const { return !failed; }
+
+private:
+    std::string_view json;
+    std::size_t pos = 0;
+    bool started = false;
+    bool finished = false;
+    bool failed = false;
+
+    bool fail() { failed = true; return false; }
+    bool finish();
+};
+
+// Pull reader over the structural index from buildStructuralIndex().
+// Same contract as JsonReader, and nested containers are checked by the
+// same grammar, but tokens are located by walking the index: inside
+// containers only the bytes of numbers and literals are read.
+class JsonStructuralReader {
+public:
+    JsonStructuralReader(std::string_view json, const std::vector<std::uint32_t>& index)
+        : json(json), index(index) {}
+
+    bool next(JsonField& field);
+    bool ok() const { return !failed; }
+
+private:
+    std::string_view json;
+    const std::vector<std::uint32_t>& index;
+    std::size_t cursor = 0;     // Next unread index entry
+    std::size_t pos = 0;        // Byte after the last consumed token
+    bool started = false;
+    bool finished = false;
+    bool failed = false;
+
+    bool fail() { failed = true; return false; }
+    bool finish();
+    bool expect(char c);
+    bool readString(std::string_view& contents, bool& escaped);
+    bool readContainer(JsonValue& value);
+};
+
+// Reader over the members of a top-level object that picks the strategy by
+// size. Documents of at least kStructuralIndexThreshold bytes go through the
+// SIMD structural index first; smaller ones are read directly, where
+// building the index would cost more than it saves.
+class JsonObjectReader {
+public:
+    static constexpr std::size_t kStructuralIndexThreshold = 2048;
+
+    explicit JsonObjectReader(std::string_view json);
+
+    bool next(JsonField& field) {
+        return indexed ? indexValid && structural.next(field) : direct.next(field);
+    }
+
+    bool ok() const {
+        return indexed ? indexValid && structural.ok() : direct.ok();
+    }
+
+private:
+    JsonReader direct;
+    JsonStructuralReader structural;
+    bool indexed;
+    bool indexValid = false;
+};
+
+// Append text as a quoted JSON string, escaping as needed
+void appendJsonString(std::string& out, std::string_view text);
+
+// Append a number in its shortest round-trip form; non-finite doubles
+// become null
+void appendJsonNumber(std::string& out, std::int64_t value);
+void appendJsonNumber(std::string& out, double value);
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "cbor.h"
+#include "http_response.h"
+#include "json.h"
+#include "msgpack.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+// Typed binding of an API request body onto a plain struct.
+//
+// A request type lists its members once by specializing JsonBinding:
+//
+//     template <> struct JsonBinding<GuessRequest> {
+//         static constexpr auto fields = std::make_tuple(
+//             jsonField("guess", &GuessRequest::guess),
+//             jsonOptional("max", &GuessRequest::max));
+//     };
+//
+// bindJson() then fills the struct in one pass over the body; bindBody()
+// does the same for a body in any negotiated WireFormat. Each key is
+// hashed once and matched against hashes computed at compile time, and each
+// value is converted straight into its member. Missing required fields,
+// values of the wrong type and malformed bodies are returned as a status,
+// not thrown. Optional members keep their initial value when absent.
+
+enum class JsonBindStatus {
+    Ok,
+    Malformed,
+    Missing,
+    WrongType
+};
+
+struct JsonBindResult {
+    JsonBindStatus status = JsonBindStatus::Ok;
+    std::string_view field;     // Offending key, for Missing and WrongType
+
+    bool ok() const { return status == JsonBindStatus::Ok; }
+};
+
+// FNV-1a over the raw key bytes
+constexpr std::uint32_t jsonKeyHash(std::string_view key) {
+    std::uint32_t hash = 2166136261u;
+    for (char c : key) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+template <typename Struct, typename Member>
+struct JsonFieldSpec {
+    std::string_view key;
+    Member Struct::* member;
+    bool required;
+    std::uint32_t hash;
+};
+
+template <typename Struct, typename Member>
+constexpr JsonFieldSpec<Struct, Member> jsonField(std::string_view key, Member Struct::* member) {
+    return {key, member, true, jsonKeyHash(key)};
+}
+
+template <typename Struct, typename Member>
+constexpr JsonFieldSpec<Struct, Member> jsonOptional(std::string_view key, Member Struct::* member) {
+    return {key, member, false, jsonKeyHash(key)};
+}
+
+// Specialized per request type with a static constexpr tuple named fields
+template <typename T>
+struct JsonBinding;
+
+namespace json_bind_detail {
+
+// Value conversions, one per supported member type
+inline bool bindValue(const JsonValue& value, int& out) { return value.asInt(out); }
+inline bool bindValue(const JsonValue& value, std::int64_t& out) { return value.asInt64(out); }
+inline bool bindValue(const JsonValue& value, double& out) { return value.asDouble(out); }
+inline bool bindValue(const JsonValue& value, bool& out) { return value.asBool(out); }
+
+inline bool bindValue(const JsonValue& value, std::string& out) {
+    out.clear();
+    return value.asString(out);
+}
+
+// Kept undecoded for the handler to inspect
+inline bool bindValue(const JsonValue& value, JsonValue& out) {
+    out = value;
+    return true;
+}
+
+template <typename Fields, std::size_t... I>
+constexpr bool hashesDistinct(const Fields& fields, std::index_sequence<I...>) {
+    const std::uint32_t hashes[] = {std::get<I>(fields).hash...};
+    for (std::size_t a = 0; a < sizeof...(I); a++) {
+        for (std::size_t b = a + 1; b < sizeof...(I); b++) {
+            if (hashes[a] == hashes[b]) return false;
+        }
+    }
+    return true;
+}
+
+template <typename Spec>
+bool keyMatches(const Spec& spec, const JsonField& field, std::uint32_t hash) {
+    if (field.keyEscaped) {
+        return field.keyEquals(spec.key);
+    }
+    return spec.hash == hash && spec.key == field.key;
+}
+
+// Bind field to the first spec whose key matches. Returns the spec's
+// position, or -1 if the key is unknown; typeOk reports the conversion.
+template <typename T, typename Fields, std::size_t... I>
+int bindField(T& out, const Fields& fields, const JsonField& field, bool& typeOk,
+              std::index_sequence<I...>) {
+    std::uint32_t hash = field.keyEscaped ? 0 : jsonKeyHash(field.key);
+    int matched = -1;
+    ((keyMatches(std::get<I>(fields), field, hash) &&
+      (matched = static_cast<int>(I), typeOk = bindValue(field.value, out.*(std::get<I>(fields).member)), true)) ||
+     ...);
+    return matched;
+}
+
+template <typename Fields, std::size_t... I>
+bool findMissing(const Fields& fields, std::uint32_t seen, std::string_view& missing,
+                 std::index_sequence<I...>) {
+    return ((std::get<I>(fields).required && !(seen & (std::uint32_t(1) << I)) &&
+             (missing = std::get<I>(fields).key, true)) ||
+            ...);
+}
+
+} // namespace json_bind_detail
+
+template <typename T, typename Reader>
+JsonBindResult bindFields(Reader& reader, T& out) {
+    constexpr auto& fields = JsonBinding<T>::fields;
+    constexpr std::size_t fieldCount = std::tuple_size<std::decay_t<decltype(fields)>>::value;
+    using Indices = std::make_index_sequence<fieldCount>;
+    static_assert(fieldCount <= 32, "too many fields to track in the seen mask");
+    static_assert(json_bind_detail::hashesDistinct(fields, Indices{}), "field key hashes collide");
+
+    JsonBindResult result;
+    std::uint32_t seen = 0;
+    JsonField field;
+    while (reader.next(field)) {
+        bool typeOk = true;
+        int matched = json_bind_detail::bindField(out, fields, field, typeOk, Indices{});
+        if (matched < 0) {
+            continue;   // Unknown keys are ignored
+        }
+        if (!typeOk) {
+            result.status = JsonBindStatus::WrongType;
+            result.field = field.key;
+            return result;
+        }
+        seen |= std::uint32_t(1) << matched;
+    }
+
+    if (!reader.ok()) {
+        result.status = JsonBindStatus::Malformed;
+        return result;
+    }
+    if (json_bind_detail::findMissing(fields, seen, result.field, Indices{})) {
+        result.status = JsonBindStatus::Missing;
+    }
+    return result;
+}
+
+template <typename T>
+JsonBindResult bindJson(std::string_view json, T& out) {
+    JsonObjectReader reader(json);
+    return bindFields(reader, out);
+}
+
+template <typename T>
+JsonBindResult bindBody(std::string_view body, WireFormat format, T& out) {
+    switch (format) {
+        case WireFormat::MessagePack: {
+            MsgPackReader reader(body);
+            return bindFields(reader, out);
+        }
+        case WireFormat::Cbor: {
+            CborReader reader(body);
+            return bindFields(reader, out);
+        }
+        case WireFormat::Json:
+            break;
+    }
+    return bindJson(body, out);
+}
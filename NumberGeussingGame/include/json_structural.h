@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// simdjson-style stage 1 for large JSON documents.
+//
+// The input is classified 64 bytes at a time with SIMD compares into bitmasks
+// of quotes, backslashes and structural characters ({ } [ ] : ,). Quotes
+// escaped by an odd run of backslashes are dropped, a prefix XOR over the
+// remaining quotes gives the in-string mask, and the positions of every
+// structural character outside strings plus every real quote are written to
+// index. Stage 2 (JsonStructuralReader) walks that index instead of the bytes,
+// so string contents inside nested containers are never rescanned.
+//
+// Returns false if the document ends inside a string.
+bool buildStructuralIndex(std::string_view json, std::vector<std::uint32_t>& index);
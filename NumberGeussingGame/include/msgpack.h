@@ -0,0 +1,48 @@
+#pragma once
+
+#include "json.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// MessagePack encoding and decoding for the API, alongside the JSON ones.
+// The encoders append to a caller-owned buffer and pick the smallest form
+// for each value. The reader hands out the same JsonField/JsonValue views
+// as JsonReader, so request binding does not care which format arrived.
+
+void appendMsgPackString(std::string& out, std::string_view text);
+void appendMsgPackInt(std::string& out, std::int64_t value);
+void appendMsgPackDouble(std::string& out, double value);
+void appendMsgPackBool(std::string& out, bool value);
+void appendMsgPackNil(std::string& out);
+void appendMsgPackArrayHeader(std::string& out, std::uint32_t count);
+
+// Map header for count entries, in the smallest form
+void appendMsgPackMapHeader(std::string& out, std::uint32_t count);
+
+// Pull reader over the members of a top-level map with string keys.
+// Strings are returned as views into the input; integers and floats are
+// decoded into the value. Nested maps and arrays are skipped and returned
+// as raw byte views typed Object or Array. Nothing may follow the map.
+class MsgPackReader {
+public:
+    explicit MsgPackReader(std::string_view data) : data(data) {}
+
+    // Next member; false at the end of the map or on malformed input
+    bool next(JsonField& field);
+
+    // False if the input was not a well-formed map
+    bool ok() const { return !failed; }
+
+private:
+    std::string_view data;
+    std::size_t pos = 0;
+    std::uint32_t remaining = 0;
+    bool started = false;
+    bool finished = false;
+    bool failed = false;
+
+    bool fail() { failed = true; return false; }
+    bool finish();
+};
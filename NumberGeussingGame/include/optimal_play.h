@@ -0,0 +1,40 @@
+#pragma once
+
+#include "game_rules.h"
+#include <atomic>
+#include <cstdint>
+
+// Best possible play under the hot/cold clue model.
+//
+// After any sequence of clues the possible targets form one interval, so
+// the minimum expected attempts is a dynamic program over sub-intervals of
+// the range: for each interval, try every guess in the range, and add the
+// cost of each interval its clues can leave. Guesses outside the interval
+// are allowed when their band splits it. O(n^3) in the number of values,
+// so only ranges up to kOptimalPlayMaxSpan are solved.
+
+constexpr std::uint64_t kOptimalPlayMaxSpan = 200;
+
+// Minimum expected attempts with the target uniform over span + 1 values;
+// span must not exceed kOptimalPlayMaxSpan
+double optimalExpectedAttempts(std::uint64_t span, const ClueThresholds& thresholds = kDefaultClueThresholds);
+
+// Solved ranges by span, for the server's default thresholds. Solving
+// every span takes seconds, so the server solves the built-in difficulties
+// before taking traffic and the rest on a background thread; requests only
+// ever look a span up.
+class OptimalPlayCache {
+public:
+    // Solve one span now; span must not exceed kOptimalPlayMaxSpan
+    void solve(std::uint64_t span);
+
+    // Solve every span not solved yet, smallest first
+    void solveAll();
+
+    // False if the span is too large or not solved yet
+    bool lookup(std::uint64_t span, double& expected) const;
+
+private:
+    double bySpan[kOptimalPlayMaxSpan + 1] = {};
+    std::atomic<bool> solved[kOptimalPlayMaxSpan + 1] = {};
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Compile-time route dispatch.
+//
+// Routes are listed once in a constexpr array. RouteTable searches, at compile
+// time, for a hash seed that puts every route in its own slot, so dispatch
+// is a few hash probes and one string compare no matter how many routes
+// exist. Prefix routes match on the first path segment ("/css/" matches
+// "/css/style.css"). An empty method matches any method.
+
+enum class RouteMatch {
+    Exact,
+    Prefix
+};
+
+template <typename Handler>
+struct Route {
+    std::string_view method;
+    std::string_view path;
+    RouteMatch match = RouteMatch::Exact;
+    Handler handler = nullptr;
+};
+
+namespace router_detail {
+
+constexpr std::uint32_t hashRoute(std::string_view method, std::string_view path, RouteMatch match, std::uint32_t seed) {
+    // FNV-1a over "method path", mixed with the seed and match kind
+    std::uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u) ^ static_cast<std::uint32_t>(match);
+    for (char c : method) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    hash = (hash ^ ' ') * 16777619u;
+    for (char c : path) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+constexpr std::size_t slotCountFor(std::size_t routes) {
+    std::size_t slots = 4;
+    while (slots < routes * 2) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+} // namespace router_detail
+
+template <typename Handler, std::size_t N>
+class RouteTable {
+public:
+    static constexpr std::size_t kSlots = router_detail::slotCountFor(N);
+    static constexpr std::uint32_t kNoSeed = 0xFFFFFFFFu;
+
+    constexpr explicit RouteTable(const Route<Handler> (&routes)[N]) {
+        for (std::size_t i = 0; i < N; i++) {
+            routes_[i] = routes[i];
+        }
+
+        seed_ = kNoSeed;
+        for (std::uint32_t seed = 0; seed < 100000 && seed_ == kNoSeed; seed++) {
+            if (placeAll(seed)) {
+                seed_ = seed;
+            }
+        }
+    }
+
+    // False if no collision-free seed exists, e.g. a route is listed twice
+    constexpr bool valid() const {
+        return seed_ != kNoSeed;
+    }
+
+    const Route<Handler>* find(std::string_view method, std::string_view path) const {
+        if (const Route<Handler>* route = probe(method, path, RouteMatch::Exact)) return route;
+        if (const Route<Handler>* route = probe(std::string_view(), path, RouteMatch::Exact)) return route;
+
+        // First path segment including both slashes, e.g. "/css/"
+        if (path.size() > 1 && path[0] == '/') {
+            std::size_t slash = path.find('/', 1);
+            if (slash != std::string_view::npos) {
+                std::string_view segment = path.substr(0, slash + 1);
+                if (const Route<Handler>* route = probe(method, segment, RouteMatch::Prefix)) return route;
+                if (const Route<Handler>* route = probe(std::string_view(), segment, RouteMatch::Prefix)) return route;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    static constexpr std::size_t kEmpty = N;
+
+    Route<Handler> routes_[N] = {};
+    std::size_t slots_[kSlots] = {};
+    std::uint32_t seed_ = kNoSeed;
+
+    static constexpr std::size_t slotOf(std::string_view method, std::string_view path, RouteMatch match, std::uint32_t seed) {
+        return router_detail::hashRoute(method, path, match, seed) & (kSlots - 1);
+    }
+
+    constexpr bool placeAll(std::uint32_t seed) {
+        for (std::size_t s = 0; s < kSlots; s++) {
+            slots_[s] = kEmpty;
+        }
+        for (std::size_t i = 0; i < N; i++) {
+            std::size_t slot = slotOf(routes_[i].method, routes_[i].path, routes_[i].match, seed);
+            if (slots_[slot] != kEmpty) {
+                return false;
+            }
+            slots_[slot] = i;
+        }
+        return true;
+    }
+
+    const Route<Handler>* probe(std::string_view method, std::string_view path, RouteMatch match) const {
+        std::size_t index = slots_[slotOf(method, path, match, seed_)];
+        if (index == kEmpty) {
+            return nullptr;
+        }
+        const Route<Handler>& route = routes_[index];
+        if (route.match != match || route.method != method || route.path != path) {
+            return nullptr;
+        }
+        return &route;
+    }
+};
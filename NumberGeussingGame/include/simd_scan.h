@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Vectorized byte scanning for the HTTP parser.
+//
+// Each function returns a pointer to the first matching byte in [p, end), or
+// end if there is none. AVX2 handles 32 bytes per step when the compiler
+// targets it (-mavx2 or -march=native), SSE2 handles 16 bytes on any x86-64
+// build, and a scalar loop covers the tail and other architectures.
+// Loads never read past end.
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SIMD_SCAN_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SIMD_SCAN_SSE2 1
+#endif
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace simd {
+
+inline unsigned countTrailingZeros(std::uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline unsigned countTrailingZeros64(std::uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    std::uint32_t low = static_cast<std::uint32_t>(mask);
+    return low ? countTrailingZeros(low) : 32 + countTrailingZeros(static_cast<std::uint32_t>(mask >> 32));
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+// First occurrence of c
+inline const char* findByte(const char* p, const char* end, char c) {
+#if defined(SIMD_SCAN_AVX2)
+    const __m256i needle32 = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle32)));
+        if (mask) return p + countTrailingZeros(mask);
+        p += 32;
+    }
+#endif
+#if defined(SIMD_SCAN_SSE2)
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        if (mask) return p + countTrailingZeros(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != c) {
+        p++;
+    }
+    return p;
+}
+
+// First occurrence of a or b
+inline const char* findEither(const char* p, const char* end, char a, char b) {
+#if defined(SIMD_SCAN_AVX2)
+    const __m256i needleA32 = _mm256_set1_epi8(a);
+    const __m256i needleB32 = _mm256_set1_epi8(b);
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, needleA32), _mm256_cmpeq_epi8(block, needleB32));
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask) return p + countTrailingZeros(mask);
+        p += 32;
+    }
+#endif
+#if defined(SIMD_SCAN_SSE2)
+    const __m128i needleA = _mm_set1_epi8(a);
+    const __m128i needleB = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, needleA), _mm_cmpeq_epi8(block, needleB));
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(hits));
+        if (mask) return p + countTrailingZeros(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != a && *p != b) {
+        p++;
+    }
+    return p;
+}
+
+} // namespace simd
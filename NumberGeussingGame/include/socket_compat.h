@@ -0,0 +1,24 @@
+#pragma once
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef SOCKET socket_t;
+    #define CLOSE_SOCKET closesocket
+    #define SOCKET_ERROR_CODE WSAGetLastError()
+    #define POLL_SOCKETS WSAPoll
+#else
+    #include <unistd.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    typedef int socket_t;
+    #define CLOSE_SOCKET close
+    #define SOCKET_ERROR_CODE errno
+    #define INVALID_SOCKET -1
+    #define POLL_SOCKETS poll
+#endif
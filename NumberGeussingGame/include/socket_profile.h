@@ -0,0 +1,38 @@
+#pragma once
+
+#include "socket_compat.h"
+#include <iostream>
+
+// TCP options applied to the listening socket and every accepted connection.
+//
+// The server exchanges tiny request/response pairs, so the defaults favour
+// latency: Nagle is disabled, delayed ACKs are suppressed, accept() only wakes
+// once the request bytes have arrived and TCP Fast Open is enabled.
+// Options the platform doesn't support are skipped.
+//
+// Configured from the environment:
+//   NGG_SOCKET_PROFILE    "low-latency" (default) or "default" for plain sockets
+//   NGG_TCP_NODELAY       0/1
+//   NGG_TCP_QUICKACK      0/1
+//   NGG_TCP_DEFER_ACCEPT  seconds to wait for data before accept(), 0 = off
+//   NGG_TCP_FASTOPEN      Fast Open queue length, 0 = off
+//   NGG_SO_BUSY_POLL      busy-poll budget in microseconds, 0 = off
+struct SocketProfile {
+    const char* name = "low-latency";
+    bool noDelay = true;
+    bool quickAck = true;
+    int deferAcceptSeconds = 1;
+    int fastOpenQueue = 16;
+    int busyPollMicros = 0;
+
+    static SocketProfile fromEnvironment();
+
+    // Listener-level options (DEFER_ACCEPT, Fast Open, busy-poll)
+    void applyToListener(socket_t listener) const;
+
+    // Per-connection options (NODELAY, QUICKACK, busy-poll)
+    void applyToClient(socket_t client) const;
+
+    // Print the effective settings at startup
+    void report(std::ostream& out) const;
+};
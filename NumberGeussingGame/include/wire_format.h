@@ -0,0 +1,84 @@
+#pragma once
+
+#include "http_request.h"
+#include "http_response.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Content negotiation and format-agnostic body builders for the API.
+//
+// Clients choose the response encoding with Accept (application/json,
+// application/msgpack or application/cbor, honouring q-values) and declare
+// request bodies with Content-Type. Handlers write through ObjectBuilder and
+// ArrayBuilder, which emit whichever encoding was negotiated, so they never
+// see the difference.
+
+// Response format preferred by the Accept header; JSON if none matches
+WireFormat acceptedFormat(std::string_view accept);
+
+// Request body format from a Content-Type value; JSON if absent or unknown
+WireFormat bodyFormat(std::string_view contentType);
+
+inline WireFormat acceptedFormat(const HttpRequest& request) {
+    return acceptedFormat(request.headers.get(KnownHeader::Accept));
+}
+
+inline WireFormat bodyFormat(const HttpRequest& request) {
+    return bodyFormat(request.headers.get(KnownHeader::ContentType));
+}
+
+// One object (map), appended to a caller-owned buffer in the given format
+class ObjectBuilder {
+public:
+    ObjectBuilder(std::string& out, WireFormat format);
+
+    ObjectBuilder& add(std::string_view key, std::string_view value);
+    // Without this a string literal would convert to bool
+    ObjectBuilder& add(std::string_view key, const char* value) { return add(key, std::string_view(value)); }
+    ObjectBuilder& add(std::string_view key, const std::string& value) { return add(key, std::string_view(value)); }
+    ObjectBuilder& add(std::string_view key, int value) { return add(key, static_cast<std::int64_t>(value)); }
+    ObjectBuilder& add(std::string_view key, std::int64_t value);
+    ObjectBuilder& add(std::string_view key, double value);
+    ObjectBuilder& add(std::string_view key, bool value);
+
+    // Splice in count key/value pairs taken from another builder's fields(),
+    // in the same format
+    ObjectBuilder& addEncoded(std::string_view encoded, std::uint32_t count);
+
+    // The pairs added so far, encoded, for reuse with addEncoded(). Every
+    // format opens an object with a single byte, which is skipped.
+    std::string_view fields() const { return std::string_view(out).substr(start + 1); }
+    std::uint32_t fieldCount() const { return count; }
+
+    // Close the object
+    void build();
+
+private:
+    std::string& out;
+    WireFormat format;
+    std::size_t start;
+    std::uint32_t count = 0;
+
+    void addKey(std::string_view key);
+};
+
+// Array of count elements. MessagePack has no open-ended arrays, so the
+// count is written up front there; JSON and CBOR do not need it. Call
+// item() before appending each element.
+class ArrayBuilder {
+public:
+    ArrayBuilder(std::string& out, WireFormat format, std::uint32_t count);
+
+    void item();
+
+    // Close the array; MessagePack elements never appended are sent as nil
+    void build();
+
+private:
+    std::string& out;
+    WireFormat format;
+    std::uint32_t count;
+    std::uint32_t items = 0;
+};
@@ -0,0 +1,351 @@
+#include "../include/cbor.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+enum Major {
+    kUnsigned = 0,
+    kNegative = 1,
+    kBytes = 2,
+    kText = 3,
+    kArray = 4,
+    kMap = 5,
+    kTag = 6,
+    kSimple = 7
+};
+
+constexpr unsigned char kBreak = 0xFF;
+
+// Nesting allowed while skipping containers
+constexpr int kMaxDepth = 32;
+
+void appendHead(std::string& out, int major, std::uint64_t value) {
+    char buffer[9];
+    unsigned char prefix = static_cast<unsigned char>(major << 5);
+    int bytes;
+    if (value < 24) {
+        out.push_back(static_cast<char>(prefix | value));
+        return;
+    } else if (value <= 0xFF) {
+        buffer[0] = static_cast<char>(prefix | 24);
+        bytes = 1;
+    } else if (value <= 0xFFFF) {
+        buffer[0] = static_cast<char>(prefix | 25);
+        bytes = 2;
+    } else if (value <= 0xFFFFFFFF) {
+        buffer[0] = static_cast<char>(prefix | 26);
+        bytes = 4;
+    } else {
+        buffer[0] = static_cast<char>(prefix | 27);
+        bytes = 8;
+    }
+    for (int i = bytes; i >= 1; i--) {
+        buffer[i] = static_cast<char>(value & 0xFF);
+        value >>= 8;
+    }
+    out.append(buffer, bytes + 1);
+}
+
+struct Head {
+    int major = 0;
+    int info = 0;               // Additional information bits
+    std::uint64_t argument = 0;
+    bool indefinite = false;
+};
+
+bool readHead(std::string_view data, std::size_t& pos, Head& head) {
+    if (pos >= data.size()) {
+        return false;
+    }
+    unsigned char initial = static_cast<unsigned char>(data[pos++]);
+    head.major = initial >> 5;
+    head.info = initial & 0x1F;
+    head.indefinite = false;
+
+    if (head.info < 24) {
+        head.argument = head.info;
+        return true;
+    }
+    if (head.info <= 27) {
+        std::size_t bytes = std::size_t(1) << (head.info - 24);
+        if (data.size() - pos < bytes) {
+            return false;
+        }
+        head.argument = 0;
+        for (std::size_t i = 0; i < bytes; i++) {
+            head.argument = (head.argument << 8) | static_cast<unsigned char>(data[pos + i]);
+        }
+        pos += bytes;
+        return true;
+    }
+    if (head.info == 31 && head.major >= kBytes && head.major != kTag) {
+        head.indefinite = true;     // Or a break, for major type 7
+        return true;
+    }
+    return false;                   // 28-30 are reserved
+}
+
+double halfToDouble(std::uint16_t half) {
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = mantissa == 0 ? INFINITY : NAN;
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+// Skip one complete item, nested containers included, without recursion.
+// Each stack entry counts the items still due in an open container, or is
+// kUntilBreak for an indefinite one.
+bool skipItem(std::string_view data, std::size_t& pos) {
+    constexpr std::uint64_t kUntilBreak = ~std::uint64_t(0);
+    std::uint64_t stack[kMaxDepth];
+    int depth = 0;
+    stack[depth++] = 1;
+
+    while (depth > 0) {
+        std::uint64_t& due = stack[depth - 1];
+        if (due == 0) {
+            depth--;
+            continue;
+        }
+        if (due == kUntilBreak) {
+            if (pos >= data.size()) return false;
+            if (static_cast<unsigned char>(data[pos]) == kBreak) {
+                pos++;
+                depth--;
+                continue;
+            }
+        } else {
+            due--;
+        }
+
+        Head head;
+        if (!readHead(data, pos, head)) {
+            return false;
+        }
+        std::uint64_t children = 0;
+        switch (head.major) {
+            case kUnsigned:
+            case kNegative:
+                break;
+            case kBytes:
+            case kText:
+                if (head.indefinite) {
+                    children = kUntilBreak;     // Chunks follow
+                } else if (data.size() - pos < head.argument) {
+                    return false;
+                } else {
+                    pos += head.argument;
+                }
+                break;
+            case kArray:
+                children = head.indefinite ? kUntilBreak : head.argument;
+                break;
+            case kMap:
+                if (head.indefinite) {
+                    children = kUntilBreak;
+                } else if (head.argument > data.size()) {
+                    return false;
+                } else {
+                    children = 2 * head.argument;
+                }
+                break;
+            case kTag:
+                children = 1;
+                break;
+            case kSimple:
+                if (head.indefinite) return false;  // Break outside a container
+                break;
+        }
+        if (children == 0) {
+            continue;
+        }
+        // Every item takes at least one byte
+        if ((children != kUntilBreak && children > data.size() - pos) || depth == kMaxDepth) {
+            return false;
+        }
+        stack[depth++] = children;
+    }
+    return true;
+}
+
+bool readValue(std::string_view data, std::size_t& pos, JsonValue& value) {
+    for (;;) {
+        std::size_t start = pos;
+        Head head;
+        if (!readHead(data, pos, head)) {
+            return false;
+        }
+        switch (head.major) {
+            case kUnsigned:
+                value = head.argument > static_cast<std::uint64_t>(INT64_MAX)
+                    ? JsonValue::fromReal(static_cast<double>(head.argument))
+                    : JsonValue::fromInteger(static_cast<std::int64_t>(head.argument));
+                return true;
+            case kNegative:
+                value = head.argument > static_cast<std::uint64_t>(INT64_MAX)
+                    ? JsonValue::fromReal(-1.0 - static_cast<double>(head.argument))
+                    : JsonValue::fromInteger(-1 - static_cast<std::int64_t>(head.argument));
+                return true;
+            case kBytes:
+            case kText:
+                if (head.indefinite || data.size() - pos < head.argument) {
+                    return false;
+                }
+                value = JsonValue(JsonType::String, data.substr(pos, head.argument), false);
+                pos += head.argument;
+                return true;
+            case kArray:
+            case kMap:
+                pos = start;
+                if (!skipItem(data, pos)) return false;
+                value = JsonValue(head.major == kMap ? JsonType::Object : JsonType::Array,
+                                  data.substr(start, pos - start), false);
+                return true;
+            case kTag:
+                continue;   // Read the tagged item itself
+            case kSimple:
+                switch (head.info) {
+                    case 20: value = JsonValue(JsonType::Boolean, "false", false); return true;
+                    case 21: value = JsonValue(JsonType::Boolean, "true", false); return true;
+                    case 25: value = JsonValue::fromReal(halfToDouble(static_cast<std::uint16_t>(head.argument))); return true;
+                    case 26: {
+                        std::uint32_t bits = static_cast<std::uint32_t>(head.argument);
+                        float single;
+                        std::memcpy(&single, &bits, sizeof(single));
+                        value = JsonValue::fromReal(single);
+                        return true;
+                    }
+                    case 27: {
+                        double real;
+                        std::memcpy(&real, &head.argument, sizeof(real));
+                        value = JsonValue::fromReal(real);
+                        return true;
+                    }
+                    case 31:
+                        return false;   // Break where a value belongs
+                    default:
+                        // null, undefined and unassigned simple values
+                        value = JsonValue(JsonType::Null, "null", false);
+                        return true;
+                }
+        }
+        return false;
+    }
+}
+
+} // namespace
+
+void appendCborString(std::string& out, std::string_view text) {
+    appendHead(out, kText, text.size());
+    out.append(text);
+}
+
+void appendCborInt(std::string& out, std::int64_t value) {
+    if (value >= 0) {
+        appendHead(out, kUnsigned, static_cast<std::uint64_t>(value));
+    } else {
+        // -1 - value without overflowing at INT64_MIN
+        appendHead(out, kNegative, ~static_cast<std::uint64_t>(value));
+    }
+}
+
+void appendCborDouble(std::string& out, double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    char buffer[9];
+    buffer[0] = static_cast<char>(0xFB);
+    for (int i = 8; i >= 1; i--) {
+        buffer[i] = static_cast<char>(bits & 0xFF);
+        bits >>= 8;
+    }
+    out.append(buffer, sizeof(buffer));
+}
+
+void appendCborBool(std::string& out, bool value) {
+    out.push_back(static_cast<char>(value ? 0xF5 : 0xF4));
+}
+
+void appendCborNull(std::string& out) {
+    out.push_back(static_cast<char>(0xF6));
+}
+
+void appendCborArrayHeader(std::string& out, std::uint64_t count) {
+    appendHead(out, kArray, count);
+}
+
+void appendCborMapStart(std::string& out) {
+    out.push_back(static_cast<char>(0xBF));
+}
+
+void appendCborArrayStart(std::string& out) {
+    out.push_back(static_cast<char>(0x9F));
+}
+
+void appendCborBreak(std::string& out) {
+    out.push_back(static_cast<char>(kBreak));
+}
+
+// End of the map at pos; the input must end there too
+bool CborReader::finish() {
+    finished = true;
+    if (pos != data.size()) {
+        return fail();
+    }
+    return false;
+}
+
+bool CborReader::next(JsonField& field) {
+    if (failed || finished) {
+        return false;
+    }
+
+    if (!started) {
+        started = true;
+        Head head;
+        if (!readHead(data, pos, head) || head.major != kMap) {
+            return fail();
+        }
+        indefinite = head.indefinite;
+        if (!indefinite && head.argument > data.size() - pos) {
+            return fail();
+        }
+        remaining = head.argument;
+    }
+
+    if (indefinite) {
+        if (pos >= data.size()) {
+            return fail();
+        }
+        if (static_cast<unsigned char>(data[pos]) == kBreak) {
+            pos++;
+            return finish();
+        }
+    } else {
+        if (remaining == 0) {
+            return finish();
+        }
+        remaining--;
+    }
+
+    Head key;
+    if (!readHead(data, pos, key) || key.major != kText || key.indefinite ||
+        data.size() - pos < key.argument) {
+        return fail();
+    }
+    field.key = data.substr(pos, key.argument);
+    field.keyEscaped = false;
+    pos += key.argument;
+
+    if (!readValue(data, pos, field.value)) {
+        return fail();
+    }
+    return true;
+}
@@ -1,6 +1,63 @@
 #include "../include/database.h"
+#include "../include/game_rules.h"
 #include <iostream>
 
+namespace {
+
+// Text column as a view of SQLite's buffer, valid until the next step;
+// NULL reads as "Unknown"
+std::string_view columnView(sqlite3_stmt* stmt, int column) {
+    const unsigned char* text = sqlite3_column_text(stmt, column);
+    if (!text) {
+        return "Unknown";
+    }
+    return std::string_view(reinterpret_cast<const char*>(text), sqlite3_column_bytes(stmt, column));
+}
+
+// Schema migration for databases created before a column existed
+bool addColumnIfMissing(sqlite3* db, const char* table, const char* column, const char* type) {
+    std::string pragma = std::string("PRAGMA table_info(") + table + ");";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, pragma.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error reading columns of " << table << ": " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    bool found = false;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+        found = columnView(stmt, 1) == column;
+    }
+    sqlite3_finalize(stmt);
+    if (found) {
+        return true;
+    }
+    
+    std::string alter = std::string("ALTER TABLE ") + table + " ADD COLUMN " + column + " " + type + ";";
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, alter.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "Error adding column " << table << "." << column << ": " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    std::cout << "Added column " << table << "." << column << std::endl;
+    return true;
+}
+
+// SQL condition true for games on a built-in difficulty. Best scores are
+// only comparable between games of the same range, so custom games do not
+// count toward them; rows saved before ranges were stored have none and
+// were all built-in games.
+std::string builtInRange(const char* prefix) {
+    std::string p(prefix);
+    std::string condition = "(" + p + "range_min IS NULL";
+    for (const DifficultyProfile& profile : kDifficultyProfiles) {
+        condition += " OR (" + p + "range_min = " + std::to_string(profile.range.min) + " AND " + p +
+                     "range_max = " + std::to_string(profile.range.max) + ")";
+    }
+    return condition + ")";
+}
+
+} // namespace
+
 Database::Database(const std::string& db_name) : db(nullptr) {
     if (sqlite3_open(db_name.c_str(), &db) != SQLITE_OK) {
         std::cerr << "Error opening database: " << sqlite3_errmsg(db) << std::endl;
@@ -35,6 +92,8 @@ bool Database::initialize() {
         "attempts INTEGER NOT NULL,"
         "won INTEGER NOT NULL,"
         "timestamp DATETIME DEFAULT CURRENT_TIMESTAMP,"
+        "range_min INTEGER,"
+        "range_max INTEGER,"
         "FOREIGN KEY (user_id) REFERENCES users(id)"
         ");";
     
@@ -54,6 +113,12 @@ bool Database::initialize() {
         return false;
     }
     
+    // Ranges were not recorded before custom difficulties; old rows keep NULL
+    if (!addColumnIfMissing(db, "game_history", "range_min", "INTEGER") ||
+        !addColumnIfMissing(db, "game_history", "range_max", "INTEGER")) {
+        return false;
+    }
+    
     return true;
 }
 
@@ -123,7 +188,28 @@ bool Database::userExists(const std::string& username) {
     return exists;
 }
 
-bool Database::saveGame(int user_id, int target_number, int attempts, bool won) {
+int Database::countUsers() {
+    if (!db) return 0;
+    
+    const char* countSql = "SELECT COUNT(*) FROM users;";
+    
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, countSql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing statement: " << sqlite3_errmsg(db) << std::endl;
+        return 0;
+    }
+    
+    int count = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    
+    return count;
+}
+
+bool Database::saveGame(int user_id, std::int64_t target_number, int attempts, bool won,
+                        std::int64_t range_min, std::int64_t range_max) {
     if (!db) return false;
     
     // First, verify that the user_id exists to prevent foreign key constraint violations
@@ -146,7 +232,8 @@ bool Database::saveGame(int user_id, int target_number, int attempts, bool won)
     
     // Now proceed with saving the game
     const char* insertSql = 
-        "INSERT INTO game_history (user_id, target_number, attempts, won) VALUES (?, ?, ?, ?);";
+        "INSERT INTO game_history (user_id, target_number, attempts, won, range_min, range_max) "
+        "VALUES (?, ?, ?, ?, ?, ?);";
     
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, insertSql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -155,9 +242,11 @@ bool Database::saveGame(int user_id, int target_number, int attempts, bool won)
     }
     
     sqlite3_bind_int(stmt, 1, user_id);
-    sqlite3_bind_int(stmt, 2, target_number);
+    sqlite3_bind_int64(stmt, 2, target_number);
     sqlite3_bind_int(stmt, 3, attempts);
     sqlite3_bind_int(stmt, 4, won ? 1 : 0);
+    sqlite3_bind_int64(stmt, 5, range_min);
+    sqlite3_bind_int64(stmt, 6, range_max);
     
     int result = sqlite3_step(stmt);
     bool success = (result == SQLITE_DONE);
@@ -170,6 +259,56 @@ bool Database::saveGame(int user_id, int target_number, int attempts, bool won)
     return success;
 }
 
+bool Database::saveGames(const std::vector<FinishedGame>& games) {
+    if (!db) return false;
+    if (games.empty()) return true;
+    
+    // One statement per game; the user check is folded into the insert
+    const char* insertSql = 
+        "INSERT INTO game_history (user_id, target_number, attempts, won, range_min, range_max) "
+        "SELECT ?1, ?2, ?3, ?4, ?5, ?6 WHERE EXISTS (SELECT 1 FROM users WHERE id = ?1);";
+    
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, insertSql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing batch save statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "Error starting batch save: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    
+    bool success = true;
+    for (const FinishedGame& game : games) {
+        sqlite3_bind_int(stmt, 1, game.user_id);
+        sqlite3_bind_int64(stmt, 2, game.target_number);
+        sqlite3_bind_int(stmt, 3, game.attempts);
+        sqlite3_bind_int(stmt, 4, game.won ? 1 : 0);
+        sqlite3_bind_int64(stmt, 5, game.range_min);
+        sqlite3_bind_int64(stmt, 6, game.range_max);
+        
+        int result = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        if (result != SQLITE_DONE) {
+            std::cerr << "Error saving game in batch: " << sqlite3_errmsg(db) << " (code: " << result << ")" << std::endl;
+            success = false;
+            break;
+        }
+    }
+    sqlite3_finalize(stmt);
+    
+    if (sqlite3_exec(db, success ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "Error finishing batch save: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return success;
+}
+
 Database::GameStats Database::getStats() {
     GameStats stats = {0, 0, 0, 0.0};
     if (!db) return stats;
@@ -189,12 +328,12 @@ Database::GameStats Database::getStats() {
         sqlite3_finalize(statsStmt);
     }
     
-    // Get best score (minimum attempts for a win)
-    const char* bestScoreSql = 
-        "SELECT MIN(attempts) FROM game_history WHERE won = 1;";
+    // Get best score (minimum attempts for a win on a built-in difficulty)
+    static const std::string bestScoreSql =
+        "SELECT MIN(attempts) FROM game_history WHERE won = 1 AND " + builtInRange("") + ";";
     
     sqlite3_stmt* bestScoreStmt;
-    if (sqlite3_prepare_v2(db, bestScoreSql, -1, &bestScoreStmt, nullptr) == SQLITE_OK) {
+    if (sqlite3_prepare_v2(db, bestScoreSql.c_str(), -1, &bestScoreStmt, nullptr) == SQLITE_OK) {
         if (sqlite3_step(bestScoreStmt) == SQLITE_ROW && sqlite3_column_type(bestScoreStmt, 0) != SQLITE_NULL) {
             stats.best_score = sqlite3_column_int(bestScoreStmt, 0);
         }
@@ -237,12 +376,12 @@ Database::GameStats Database::getUserStats(int user_id) {
         sqlite3_finalize(statsStmt);
     }
     
-    // Get best score for user
-    const char* bestScoreSql = 
-        "SELECT MIN(attempts) FROM game_history WHERE user_id = ? AND won = 1;";
+    // Get best score for user, on built-in difficulties only
+    static const std::string bestScoreSql =
+        "SELECT MIN(attempts) FROM game_history WHERE user_id = ? AND won = 1 AND " + builtInRange("") + ";";
     
     sqlite3_stmt* bestScoreStmt;
-    if (sqlite3_prepare_v2(db, bestScoreSql, -1, &bestScoreStmt, nullptr) == SQLITE_OK) {
+    if (sqlite3_prepare_v2(db, bestScoreSql.c_str(), -1, &bestScoreStmt, nullptr) == SQLITE_OK) {
         sqlite3_bind_int(bestScoreStmt, 1, user_id);
         
         if (sqlite3_step(bestScoreStmt) == SQLITE_ROW && sqlite3_column_type(bestScoreStmt, 0) != SQLITE_NULL) {
@@ -268,14 +407,15 @@ Database::GameStats Database::getUserStats(int user_id) {
     return stats;
 }
 
-std::vector<Database::LeaderboardEntry> Database::getLeaderboard(int limit) {
-    std::cout << "Database::getLeaderboard called with limit: " << limit << std::endl;
-    std::vector<LeaderboardEntry> leaderboard;
+bool Database::forEachLeaderboardEntry(int limit, const std::function<void(const LeaderboardEntry&)>& callback) {
+    std::cout << "Database::forEachLeaderboardEntry called with limit: " << limit << std::endl;
     if (!db) {
         std::cerr << "Database connection is null" << std::endl;
-        return leaderboard;
+        return false;
     }
     
+    int rows = 0;
+    
     try {
         // Check if game_history table has any entries
         std::cout << "Checking if game_history table has entries..." << std::endl;
@@ -286,7 +426,7 @@ std::vector<Database::LeaderboardEntry> Database::getLeaderboard(int limit) {
         int rc = sqlite3_prepare_v2(db, checkSql, -1, &checkStmt, nullptr);
         if (rc != SQLITE_OK) {
             std::cerr << "Error preparing check statement: " << sqlite3_errmsg(db) << std::endl;
-            return leaderboard;
+            return false;
         }
         
         if (sqlite3_step(checkStmt) == SQLITE_ROW) {
@@ -304,7 +444,7 @@ std::vector<Database::LeaderboardEntry> Database::getLeaderboard(int limit) {
             rc = sqlite3_prepare_v2(db, userSql, -1, &userStmt, nullptr);
             if (rc != SQLITE_OK) {
                 std::cerr << "Error preparing user statement: " << sqlite3_errmsg(db) << std::endl;
-                return leaderboard;
+                return false;
             }
             
             sqlite3_bind_int(userStmt, 1, limit);
@@ -312,30 +452,26 @@ std::vector<Database::LeaderboardEntry> Database::getLeaderboard(int limit) {
             
             while (sqlite3_step(userStmt) == SQLITE_ROW) {
                 LeaderboardEntry entry;
-                const unsigned char* username = sqlite3_column_text(userStmt, 0);
-                if (username) {
-                    entry.username = reinterpret_cast<const char*>(username);
-                } else {
-                    entry.username = "Unknown";
-                }
+                entry.username = columnView(userStmt, 0);
                 entry.best_score = 0;
                 entry.games_played = 0;
                 entry.wins = 0;
                 
-                leaderboard.push_back(entry);
-                std::cout << "Added user to leaderboard: " << entry.username << std::endl;
+                callback(entry);
+                rows++;
             }
             
             sqlite3_finalize(userStmt);
-            std::cout << "Returning leaderboard with " << leaderboard.size() << " entries" << std::endl;
-            return leaderboard;
+            std::cout << "Streamed leaderboard with " << rows << " entries" << std::endl;
+            return true;
         }
         
         // Original leaderboard query for when game history exists
         std::cout << "Game history exists, running full leaderboard query..." << std::endl;
-        const char* leaderboardSql = 
+        // Ranked by best score, which only built-in difficulties count toward
+        static const std::string leaderboardSql =
             "SELECT u.username, "
-            "MIN(CASE WHEN g.won = 1 THEN g.attempts ELSE NULL END) as best_score, "
+            "MIN(CASE WHEN g.won = 1 AND " + builtInRange("g.") + " THEN g.attempts ELSE NULL END) as best_score, "
             "COUNT(g.id) as games_played, "
             "SUM(CASE WHEN g.won = 1 THEN 1 ELSE 0 END) as wins "
             "FROM users u "
@@ -345,10 +481,10 @@ std::vector<Database::LeaderboardEntry> Database::getLeaderboard(int limit) {
             "LIMIT ?;";
         
         sqlite3_stmt* stmt;
-        rc = sqlite3_prepare_v2(db, leaderboardSql, -1, &stmt, nullptr);
+        rc = sqlite3_prepare_v2(db, leaderboardSql.c_str(), -1, &stmt, nullptr);
         if (rc != SQLITE_OK) {
             std::cerr << "Error preparing leaderboard statement: " << sqlite3_errmsg(db) << std::endl;
-            return leaderboard;
+            return false;
         }
         
         sqlite3_bind_int(stmt, 1, limit);
@@ -356,12 +492,7 @@ std::vector<Database::LeaderboardEntry> Database::getLeaderboard(int limit) {
         
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             LeaderboardEntry entry;
-            const unsigned char* username = sqlite3_column_text(stmt, 0);
-            if (username) {
-                entry.username = reinterpret_cast<const char*>(username);
-            } else {
-                entry.username = "Unknown";
-            }
+            entry.username = columnView(stmt, 0);
             
             if (sqlite3_column_type(stmt, 1) != SQLITE_NULL) {
                 entry.best_score = sqlite3_column_int(stmt, 1);
@@ -372,20 +503,18 @@ std::vector<Database::LeaderboardEntry> Database::getLeaderboard(int limit) {
             entry.games_played = sqlite3_column_int(stmt, 2);
             entry.wins = sqlite3_column_int(stmt, 3);
             
-            leaderboard.push_back(entry);
-            std::cout << "Added user to leaderboard: " << entry.username 
-                      << ", score: " << entry.best_score 
-                      << ", games: " << entry.games_played
-                      << ", wins: " << entry.wins << std::endl;
+            callback(entry);
+            rows++;
         }
         
         sqlite3_finalize(stmt);
-        std::cout << "Returning complete leaderboard with " << leaderboard.size() << " entries" << std::endl;
+        std::cout << "Streamed complete leaderboard with " << rows << " entries" << std::endl;
+        return true;
     } catch (const std::exception& e) {
-        std::cerr << "Exception in getLeaderboard: " << e.what() << std::endl;
+        std::cerr << "Exception in forEachLeaderboardEntry: " << e.what() << std::endl;
     } catch (...) {
-        std::cerr << "Unknown exception in getLeaderboard" << std::endl;
+        std::cerr << "Unknown exception in forEachLeaderboardEntry" << std::endl;
     }
     
-    return leaderboard;
+    return false;
 } 
\ No newline at end of file
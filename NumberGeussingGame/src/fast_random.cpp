@@ -0,0 +1,30 @@
+#include "../include/fast_random.h"
+#include <random>
+
+Xoshiro256::Xoshiro256(std::uint64_t seed) {
+    for (std::uint64_t& word : state) {
+        seed += 0x9e3779b97f4a7c15ull;
+        std::uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        word = z ^ (z >> 31);
+    }
+}
+
+std::uint64_t OsRandom::next() {
+    thread_local std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) | rd();
+}
+
+Xoshiro256 Xoshiro256::fromOs() {
+    std::random_device rd;
+    Xoshiro256 generator((static_cast<std::uint64_t>(rd()) << 32) | rd());
+    // Fold in more entropy than one 64-bit seed carries
+    for (std::uint64_t& word : generator.state) {
+        word ^= (static_cast<std::uint64_t>(rd()) << 32) | rd();
+    }
+    if ((generator.state[0] | generator.state[1] | generator.state[2] | generator.state[3]) == 0) {
+        generator.state[0] = 1;     // The all-zero state is a fixed point
+    }
+    return generator;
+}
@@ -0,0 +1,279 @@
+#include "../include/game_rooms.h"
+#include "../include/fast_random.h"
+#include <algorithm>
+#include <iostream>
+
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif
+
+namespace {
+
+constexpr std::string_view kHeartbeatFrame = ":\n\n";
+
+void setNonBlocking(socket_t socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(socket, FIONBIO, &mode);
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags >= 0) {
+        fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+    }
+#endif
+}
+
+// One attempt at the whole frame; a partial write would leave the stream
+// mid-event, so it counts as a failure too
+bool sendFrame(socket_t socket, std::string_view bytes) {
+#ifdef MSG_NOSIGNAL
+    int n = ::send(socket, bytes.data(), static_cast<int>(bytes.size()), MSG_NOSIGNAL);
+#else
+    int n = ::send(socket, bytes.data(), static_cast<int>(bytes.size()), 0);
+#endif
+    return n == static_cast<int>(bytes.size());
+}
+
+}
+
+GameRoom::GameRoom(std::uint64_t id, DifficultyRange range)
+    : roomId(id),
+      roomRange(range),
+      members(std::make_shared<const Members>()),
+      target(randomInRange(range.min, range.max)),
+      active(std::time(nullptr)) {}
+
+GameRoom::~GameRoom() {
+    for (const RoomMember& member : *std::atomic_load(&members)) {
+        CLOSE_SOCKET(member.socket);
+    }
+}
+
+std::uint64_t GameRoom::join(socket_t socket, int userId) {
+    setNonBlocking(socket);
+    std::uint64_t token;
+    std::vector<socket_t> replaced;
+    {
+        std::lock_guard<std::mutex> lock(membershipMutex);
+        auto next = std::make_shared<Members>();
+        next->reserve(members->size() + 1);
+        for (const RoomMember& member : *members) {
+            if (member.userId == userId) {
+                replaced.push_back(member.socket);
+            } else {
+                next->push_back(member);
+            }
+        }
+        if (next->size() >= kMaxMembers) {
+            CLOSE_SOCKET(socket);
+            return 0;
+        }
+
+        OsRandom os;
+        do {
+            token = os.next();
+        } while (token == 0);
+        next->push_back(RoomMember{socket, userId, token});
+        std::atomic_store(&members, std::shared_ptr<const Members>(std::move(next)));
+    }
+    // A publish may still be writing to a replaced connection from an older
+    // snapshot; close it only once no publish is in progress
+    {
+        std::lock_guard<std::mutex> publishLock(publishMutex);
+        for (socket_t old : replaced) {
+            CLOSE_SOCKET(old);
+        }
+    }
+
+    std::lock_guard<std::mutex> roundLock(roundMutex);
+    active = std::time(nullptr);
+    return token;
+}
+
+std::size_t GameRoom::memberCount() const {
+    return std::atomic_load(&members)->size();
+}
+
+bool GameRoom::guess(std::uint64_t token, std::int64_t value, GuessOutcome& outcome) {
+    std::shared_ptr<const Members> snapshot = std::atomic_load(&members);
+    auto member = std::find_if(snapshot->begin(), snapshot->end(),
+                               [token](const RoomMember& m) { return m.token == token; });
+    if (token == 0 || member == snapshot->end()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(roundMutex);
+    active = std::time(nullptr);
+
+    outcome.userId = member->userId;
+    outcome.round = roundNumber;
+    outcome.attempts = ++attemptsByUser[member->userId];
+    outcome.target = target;
+    outcome.higher = target > value;
+
+    std::uint64_t span = static_cast<std::uint64_t>(roomRange.max) - static_cast<std::uint64_t>(roomRange.min);
+    outcome.clue = classifyDistance(distanceBetween(value, target), span);
+
+    if (outcome.clue == Clue::Correct) {
+        target = randomInRange(roomRange.min, roomRange.max);
+        roundNumber++;
+        attemptsByUser.clear();
+    }
+    return true;
+}
+
+std::uint32_t GameRoom::round() const {
+    std::lock_guard<std::mutex> lock(roundMutex);
+    return roundNumber;
+}
+
+std::time_t GameRoom::lastActive() const {
+    std::lock_guard<std::mutex> lock(roundMutex);
+    return active;
+}
+
+void GameRoom::appendFrame(std::string_view event, std::string_view data) {
+    frame.append("event: ");
+    frame.append(event);
+    frame.append("\ndata: ");
+    frame.append(data);
+    frame.append("\n\n");
+}
+
+std::uint64_t GameRoom::publish(std::string_view event, std::string_view data) {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::uint64_t sequence = nextSequence++;
+
+    frame.clear();
+    frame.append("id: ");
+    frame.append(std::to_string(sequence));
+    frame.push_back('\n');
+    appendFrame(event, data);
+
+    fanOut(frame);
+    return sequence;
+}
+
+bool GameRoom::sendTo(std::uint64_t token, std::string_view event, std::string_view data) {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::shared_ptr<const Members> snapshot = std::atomic_load(&members);
+    auto member = std::find_if(snapshot->begin(), snapshot->end(),
+                               [token](const RoomMember& m) { return m.token == token; });
+    if (token == 0 || member == snapshot->end()) {
+        return false;
+    }
+
+    frame.clear();
+    appendFrame(event, data);
+    if (!sendFrame(member->socket, frame)) {
+        drop({member->socket});
+        return false;
+    }
+    return true;
+}
+
+void GameRoom::heartbeat() {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    fanOut(kHeartbeatFrame);
+}
+
+void GameRoom::fanOut(std::string_view bytes) {
+    std::shared_ptr<const Members> snapshot = std::atomic_load(&members);
+
+    std::vector<socket_t> failed;
+    for (const RoomMember& member : *snapshot) {
+        if (!sendFrame(member.socket, bytes)) {
+            failed.push_back(member.socket);
+        }
+    }
+    if (!failed.empty()) {
+        drop(failed);
+    }
+}
+
+void GameRoom::drop(const std::vector<socket_t>& sockets) {
+    {
+        std::lock_guard<std::mutex> lock(membershipMutex);
+        auto next = std::make_shared<Members>();
+        next->reserve(members->size());
+        for (const RoomMember& member : *members) {
+            if (std::find(sockets.begin(), sockets.end(), member.socket) == sockets.end()) {
+                next->push_back(member);
+            }
+        }
+        std::atomic_store(&members, std::shared_ptr<const Members>(std::move(next)));
+    }
+
+    for (socket_t socket : sockets) {
+        CLOSE_SOCKET(socket);
+    }
+    std::cout << "Room dropped " << sockets.size() << " member(s)" << std::endl;
+}
+
+std::shared_ptr<GameRoom> RoomRegistry::create(DifficultyRange range) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (rooms.size() >= kMaxRooms) {
+        return nullptr;
+    }
+    OsRandom os;
+    std::uint64_t id;
+    do {
+        id = os.next();
+    } while (id == 0 || rooms.count(id) != 0);
+
+    auto room = std::make_shared<GameRoom>(id, range);
+    rooms.emplace(id, room);
+    return room;
+}
+
+std::shared_ptr<GameRoom> RoomRegistry::find(std::uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = rooms.find(id);
+    return it == rooms.end() ? nullptr : it->second;
+}
+
+void RoomRegistry::heartbeat() {
+    std::vector<std::shared_ptr<GameRoom>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot.reserve(rooms.size());
+        for (const auto& entry : rooms) {
+            snapshot.push_back(entry.second);
+        }
+    }
+
+    std::time_t now = std::time(nullptr);
+    for (const auto& room : snapshot) {
+        room->heartbeat();
+        if (room->memberCount() == 0 && now - room->lastActive() >= kEmptyRoomSeconds) {
+            std::lock_guard<std::mutex> lock(mutex);
+            rooms.erase(room->id());
+        }
+    }
+}
+
+std::size_t RoomRegistry::streamLimitFromDescriptors() {
+    std::size_t limit = kMaxRooms * GameRoom::kMaxMembers;
+#ifndef _WIN32
+    struct rlimit descriptors;
+    if (getrlimit(RLIMIT_NOFILE, &descriptors) == 0 && descriptors.rlim_cur != RLIM_INFINITY) {
+        std::size_t available = static_cast<std::size_t>(descriptors.rlim_cur);
+        limit = std::min(limit, available > kDescriptorHeadroom ? available - kDescriptorHeadroom : 0);
+    }
+#endif
+    return limit;
+}
+
+bool RoomRegistry::acceptsStream() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t streams = 0;
+    for (const auto& entry : rooms) {
+        streams += entry.second->memberCount();
+    }
+    return streams < streamLimit;
+}
+
+std::size_t RoomRegistry::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rooms.size();
+}
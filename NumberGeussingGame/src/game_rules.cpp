@@ -0,0 +1,63 @@
+#include "../include/game_rules.h"
+#include <array>
+#include <cstddef>
+
+namespace {
+
+// Band for every in-range distance of one difficulty
+template <int Range>
+constexpr std::array<Clue, Range + 1> makeClueTable() {
+    std::array<Clue, Range + 1> table{};
+    for (int diff = 0; diff <= Range; diff++) {
+        table[diff] = classifyDistance(diff, Range);
+    }
+    return table;
+}
+
+constexpr auto kEasyClues = makeClueTable<kEasyRange.max - kEasyRange.min>();
+constexpr auto kMediumClues = makeClueTable<kMediumRange.max - kMediumRange.min>();
+constexpr auto kHardClues = makeClueTable<kHardRange.max - kHardRange.min>();
+
+template <std::size_t N>
+bool lookUp(const std::array<Clue, N>& table, std::uint64_t diff, Clue& clue) {
+    if (diff >= N) {
+        return false;
+    }
+    clue = table[diff];
+    return true;
+}
+
+// Two per band: lower, then higher
+constexpr std::string_view kClueMessages[kClueCount * 2] = {
+    "Correct!", "Correct!",
+    "Very hot! The number is lower.", "Very hot! The number is higher.",
+    "Hot! The number is lower.", "Hot! The number is higher.",
+    "Warm. The number is lower.", "Warm. The number is higher.",
+    "Cool. The number is lower.", "Cool. The number is higher.",
+    "Cold! The number is lower.", "Cold! The number is higher.",
+};
+
+} // namespace
+
+Clue classifyGuess(std::int64_t guess, std::int64_t target, std::int64_t min, std::int64_t max) {
+    std::uint64_t diff = distanceBetween(guess, target);
+
+    Clue clue;
+    if (min == kEasyRange.min && max == kEasyRange.max && lookUp(kEasyClues, diff, clue)) return clue;
+    if (min == kMediumRange.min && max == kMediumRange.max && lookUp(kMediumClues, diff, clue)) return clue;
+    if (min == kHardRange.min && max == kHardRange.max && lookUp(kHardClues, diff, clue)) return clue;
+    return classifyDistance(diff, distanceBetween(min, max));
+}
+
+void classifyDistances(const ClueLimits& limits, const std::uint64_t* diffs, std::size_t count, Clue* clues) {
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint64_t diff = diffs[i];
+        unsigned band = 1u + (diff > limits.limit[0]) + (diff > limits.limit[1]) +
+                        (diff > limits.limit[2]) + (diff > limits.limit[3]);
+        clues[i] = static_cast<Clue>(diff == 0 ? 0u : band);
+    }
+}
+
+std::string_view clueMessage(Clue clue, bool higher) {
+    return kClueMessages[static_cast<int>(clue) * 2 + (higher ? 1 : 0)];
+}
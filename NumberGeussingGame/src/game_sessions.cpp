@@ -0,0 +1,352 @@
+#include "../include/game_sessions.h"
+#include "../include/fast_random.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+// Multipliers of the ID mix; both odd, so multiplication is invertible mod 2^64
+constexpr std::uint64_t kMixA = 0xbf58476d1ce4e5b9ull;
+constexpr std::uint64_t kMixB = 0x94d049bb133111ebull;
+
+// Newton's iteration doubles the correct low bits each step
+constexpr std::uint64_t inverseOf(std::uint64_t odd) {
+    std::uint64_t inverse = odd;
+    for (int i = 0; i < 5; i++) {
+        inverse *= 2 - odd * inverse;
+    }
+    return inverse;
+}
+
+constexpr std::uint64_t kUnmixA = inverseOf(kMixA);
+constexpr std::uint64_t kUnmixB = inverseOf(kMixB);
+static_assert(kMixA * kUnmixA == 1 && kMixB * kUnmixB == 1, "ID mix must be invertible");
+
+} // namespace
+
+std::string_view formatGameId(std::uint64_t id, char* buffer) {
+    static const char hex[] = "0123456789abcdef";
+    for (std::size_t i = 0; i < kGameIdLength; i++) {
+        buffer[kGameIdLength - 1 - i] = hex[(id >> (4 * i)) & 0xF];
+    }
+    return std::string_view(buffer, kGameIdLength);
+}
+
+bool parseGameId(std::string_view text, std::uint64_t& id) {
+    if (text.size() != kGameIdLength) {
+        return false;
+    }
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, id, 16);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Buckets are wide enough that every deadline lands less than a full turn
+// of the wheel ahead
+GameSessionStore::GameSessionStore(std::uint32_t idleSeconds)
+    : idleSeconds(idleSeconds),
+      tickSeconds(idleSeconds / (kWheelSlots - 4) + 1),
+      epoch(std::time(nullptr)) {
+    std::random_device rd;
+    for (std::uint64_t& key : idKeys) {
+        key = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+    }
+}
+
+std::uint32_t GameSessionStore::idleTimeoutFromEnvironment() {
+    const char* value = std::getenv("NGG_GAME_IDLE_SECONDS");
+    std::uint32_t seconds = 0;
+    if (value && std::from_chars(value, value + std::strlen(value), seconds).ec == std::errc() && seconds > 0) {
+        return seconds;
+    }
+    return kDefaultIdleSeconds;
+}
+
+// x ^= x >> 32 is its own inverse, so toHandle() undoes toId() step by step
+std::uint64_t GameSessionStore::toId(std::uint64_t handle) const {
+    std::uint64_t x = (handle ^ idKeys[0]) * kMixA;
+    x ^= x >> 32;
+    return (x * kMixB) ^ idKeys[1];
+}
+
+std::uint64_t GameSessionStore::toHandle(std::uint64_t id) const {
+    std::uint64_t x = (id ^ idKeys[1]) * kUnmixB;
+    x ^= x >> 32;
+    return (x * kUnmixA) ^ idKeys[0];
+}
+
+std::uint32_t GameSessionStore::now() const {
+    return static_cast<std::uint32_t>(std::time(nullptr) - epoch);
+}
+
+GameRecord* GameSessionStore::find(Shard& shard, std::uint32_t slot, std::uint32_t generation) {
+    if (slot >= shard.slots) {
+        return nullptr;
+    }
+    GameRecord& record = shard.pages[slot / kPageRecords][slot % kPageRecords];
+    return (generation & 1) && record.generation == generation ? &record : nullptr;
+}
+
+GameRecord* GameSessionStore::findTagged(Shard& shard, std::uint32_t slot, std::uint32_t tag) {
+    if (slot >= shard.slots) {
+        return nullptr;
+    }
+    GameRecord& record = shard.pages[slot / kPageRecords][slot % kPageRecords];
+    return (record.generation & 1) && record.tag == tag ? &record : nullptr;
+}
+
+void GameSessionStore::release(Shard& shard, std::uint32_t slot, GameRecord& record) {
+    record.generation++;    // Even: free; its wheel entries are stale and the next game draws a new tag
+    record.nextFree = shard.freeHead;
+    shard.freeHead = slot;
+    shard.live--;
+}
+
+// Bucket by the first tick at or after the idle deadline, so a sweep of that
+// tick finds the game expired unless it has been played since
+void GameSessionStore::schedule(Shard& shard, std::uint32_t slot, const GameRecord& record) const {
+    std::uint32_t deadline = record.lastActive + idleSeconds;
+    std::uint32_t tick = (deadline + tickSeconds - 1) / tickSeconds;
+    shard.wheel[tick % kWheelSlots].push_back((static_cast<std::uint64_t>(record.generation) << 32) | slot);
+}
+
+void GameSessionStore::copyOut(const GameRecord& record, GameSession& session) const {
+    session.userId = record.userId;
+    session.target = record.target;
+    session.min = record.min;
+    session.max = record.max;
+    session.attempts = static_cast<int>(record.attempts);
+    session.started = epoch + record.started;
+    session.lastActive = epoch + record.lastActive;
+}
+
+std::uint64_t GameSessionStore::create(int userId, std::int64_t target, std::int64_t min, std::int64_t max) {
+    std::uint32_t shardIndex = nextShard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+    Shard& shard = shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::uint32_t slot = shard.freeHead;
+    GameRecord* record;
+    if (slot != kNoSlot) {
+        record = &shard.pages[slot / kPageRecords][slot % kPageRecords];
+        shard.freeHead = record->nextFree;
+    } else {
+        slot = shard.slots++;
+        if (slot % kPageRecords == 0) {
+            shard.pages.emplace_back(new GameRecord[kPageRecords]);
+        }
+        record = &shard.pages[slot / kPageRecords][slot % kPageRecords];
+        record->generation = 0;
+    }
+
+    record->generation++;   // Odd: live
+    record->tag = static_cast<std::uint32_t>(OsRandom().next());
+    record->userId = userId;
+    record->target = target;
+    record->min = min;
+    record->max = max;
+    record->attempts = 0;
+    record->started = now();
+    record->lastActive = record->started;
+    shard.live++;
+    schedule(shard, slot, *record);
+
+    std::uint64_t index = static_cast<std::uint64_t>(slot) * kShardCount + shardIndex;
+    return toId((static_cast<std::uint64_t>(record->tag) << 32) | index);
+}
+
+bool GameSessionStore::guess(std::uint64_t id, std::int64_t guess, GameSession& session) {
+    std::uint64_t handle = toHandle(id);
+    std::uint32_t index = static_cast<std::uint32_t>(handle);
+    Shard& shard = shards[index % kShardCount];
+    std::uint32_t slot = index / kShardCount;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    GameRecord* record = findTagged(shard, slot, static_cast<std::uint32_t>(handle >> 32));
+    if (!record) {
+        return false;
+    }
+    record->attempts++;
+    record->lastActive = now();
+    copyOut(*record, session);
+    if (guess == record->target) {
+        release(shard, slot, *record);
+    }
+    return true;
+}
+
+bool GameSessionStore::end(std::uint64_t id, GameSession& session) {
+    std::uint64_t handle = toHandle(id);
+    std::uint32_t index = static_cast<std::uint32_t>(handle);
+    Shard& shard = shards[index % kShardCount];
+    std::uint32_t slot = index / kShardCount;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    GameRecord* record = findTagged(shard, slot, static_cast<std::uint32_t>(handle >> 32));
+    if (!record) {
+        return false;
+    }
+    copyOut(*record, session);
+    release(shard, slot, *record);
+    return true;
+}
+
+std::size_t GameSessionStore::expire(std::vector<GameSession>& expired) {
+    std::uint32_t current = now();
+    std::uint32_t currentTick = current / tickSeconds;
+    std::size_t ended = 0;
+
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.nextTick > currentTick) {
+            continue;
+        }
+        // After a long stall one full turn visits every bucket
+        if (currentTick - shard.nextTick >= kWheelSlots) {
+            shard.nextTick = currentTick - kWheelSlots + 1;
+        }
+
+        for (; shard.nextTick <= currentTick; shard.nextTick++) {
+            shard.due.swap(shard.wheel[shard.nextTick % kWheelSlots]);
+            for (std::uint64_t entry : shard.due) {
+                std::uint32_t slot = static_cast<std::uint32_t>(entry);
+                GameRecord* record = find(shard, slot, static_cast<std::uint32_t>(entry >> 32));
+                if (!record) {
+                    continue;   // Finished or already expired
+                }
+                if (record->lastActive + idleSeconds > current) {
+                    schedule(shard, slot, *record);
+                    continue;
+                }
+                expired.emplace_back();
+                copyOut(*record, expired.back());
+                release(shard, slot, *record);
+                ended++;
+            }
+            shard.due.clear();
+        }
+    }
+    return ended;
+}
+
+namespace {
+
+// Written ahead of the shards; a snapshot from a build that lays records out
+// differently, or splits them over a different number of shards, is refused
+struct SnapshotHeader {
+    char magic[4];
+    std::uint32_t recordSize;
+    std::uint32_t shardCount;
+    std::uint32_t pageRecords;
+    std::uint64_t idKeys[2];
+    std::int64_t epoch;
+};
+
+constexpr char kSnapshotMagic[4] = {'N', 'G', 'S', '1'};
+
+} // namespace
+
+void GameSessionStore::snapshot(std::string& out) const {
+    SnapshotHeader header;
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.recordSize = sizeof(GameRecord);
+    header.shardCount = kShardCount;
+    header.pageRecords = kPageRecords;
+    header.idKeys[0] = idKeys[0];
+    header.idKeys[1] = idKeys[1];
+    header.epoch = static_cast<std::int64_t>(epoch);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Whole pages, free slots included, so every slot keeps its index
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        out.append(reinterpret_cast<const char*>(&shard.slots), sizeof(shard.slots));
+        for (std::uint32_t slot = 0; slot < shard.slots; slot += kPageRecords) {
+            std::uint32_t count = std::min(kPageRecords, shard.slots - slot);
+            out.append(reinterpret_cast<const char*>(shard.pages[slot / kPageRecords].get()),
+                       count * sizeof(GameRecord));
+        }
+    }
+}
+
+bool GameSessionStore::restore(std::string_view data) {
+    SnapshotHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 ||
+        header.recordSize != sizeof(GameRecord) || header.shardCount != kShardCount ||
+        header.pageRecords != kPageRecords) {
+        return false;
+    }
+
+    // Check the sizes before touching any shard
+    std::size_t pos = sizeof(header);
+    for (std::uint32_t i = 0; i < kShardCount; i++) {
+        std::uint32_t slots;
+        if (data.size() - pos < sizeof(slots)) {
+            return false;
+        }
+        std::memcpy(&slots, data.data() + pos, sizeof(slots));
+        pos += sizeof(slots);
+        if ((data.size() - pos) / sizeof(GameRecord) < slots) {
+            return false;
+        }
+        pos += slots * sizeof(GameRecord);
+    }
+    if (pos != data.size()) {
+        return false;
+    }
+
+    idKeys[0] = header.idKeys[0];
+    idKeys[1] = header.idKeys[1];
+    epoch = static_cast<std::time_t>(header.epoch);
+
+    pos = sizeof(header);
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::memcpy(&shard.slots, data.data() + pos, sizeof(shard.slots));
+        pos += sizeof(shard.slots);
+        for (std::uint32_t slot = 0; slot < shard.slots; slot += kPageRecords) {
+            std::uint32_t count = std::min(kPageRecords, shard.slots - slot);
+            shard.pages.emplace_back(new GameRecord[kPageRecords]);
+            std::memcpy(shard.pages.back().get(), data.data() + pos, count * sizeof(GameRecord));
+            pos += count * sizeof(GameRecord);
+        }
+
+        // Free list and timing wheel are rebuilt rather than trusted
+        for (std::uint32_t slot = shard.slots; slot-- > 0;) {
+            GameRecord& record = shard.pages[slot / kPageRecords][slot % kPageRecords];
+            if (record.generation & 1) {
+                shard.live++;
+                schedule(shard, slot, record);
+            } else {
+                record.nextFree = shard.freeHead;
+                shard.freeHead = slot;
+            }
+        }
+    }
+    return true;
+}
+
+std::size_t GameSessionStore::size() const {
+    std::size_t total = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.live;
+    }
+    return total;
+}
+
+std::size_t GameSessionStore::reservedBytes() const {
+    std::size_t total = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.pages.size() * kPageRecords * sizeof(GameRecord);
+    }
+    return total;
+}
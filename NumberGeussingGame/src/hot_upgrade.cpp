@@ -0,0 +1,419 @@
+#include "../include/hot_upgrade.h"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <climits>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <sys/wait.h>
+#endif
+
+namespace {
+
+// Environment variable carrying the handoff channel descriptor to the new binary
+const char* const kHandoffEnv = "NGG_HANDOFF_FD";
+
+// How long the old process waits for the new one to start accepting, and
+// the new one for the old one's state
+const int kReadyTimeoutMs = 10000;
+
+// Largest state the new process will take; anything bigger is not ours
+const std::uint64_t kMaxStateBytes = std::uint64_t(1) << 32;
+
+#ifndef _WIN32
+volatile sig_atomic_t upgradeRequested = 0;
+
+// Channel to the previous process, kept open until confirmReady()
+int handoffChannel = -1;
+
+// Absolute path of this binary, resolved at startup
+std::string executablePath;
+
+// Upgrade in progress: channel to the new process, its pid and deadline
+int pendingChannel = -1;
+pid_t pendingPid = -1;
+std::chrono::steady_clock::time_point pendingDeadline;
+
+// Channel to a new process that has reported ready, until sendState()
+int readyChannel = -1;
+
+bool isExecutableFile(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode) && access(path.c_str(), X_OK) == 0;
+}
+
+std::string absolutePath(const std::string& path) {
+    char* resolved = realpath(path.c_str(), nullptr);
+    if (!resolved) {
+        return std::string();
+    }
+    std::string result(resolved);
+    std::free(resolved);
+    return result;
+}
+
+// Close the channel to the new process and kill it, or keep the channel
+// for sendState() if it took over
+void endPendingHandOff(bool tookOver) {
+    if (tookOver) {
+        readyChannel = pendingChannel;
+    } else {
+        close(pendingChannel);
+        kill(pendingPid, SIGTERM);
+        waitpid(pendingPid, nullptr, 0);
+    }
+    pendingChannel = -1;
+    pendingPid = -1;
+}
+
+bool sendAll(int channel, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = send(channel, data, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Read exactly size bytes unless the deadline passes or the peer goes away
+bool receiveAll(int channel, char* data, std::size_t size, std::chrono::steady_clock::time_point deadline) {
+    while (size > 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+        struct pollfd pfd;
+        pfd.fd = channel;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, static_cast<int>(left.count()));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        ssize_t n = recv(channel, data, size, 0);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+void onUpgradeSignal(int) {
+    upgradeRequested = 1;
+}
+
+bool sendDescriptor(int channel, int fd) {
+    char payload = 'L';
+    struct iovec iov;
+    iov.iov_base = &payload;
+    iov.iov_len = 1;
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    std::memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    return sendmsg(channel, &msg, MSG_NOSIGNAL) == 1;
+}
+
+int receiveDescriptor(int channel) {
+    char payload = 0;
+    struct iovec iov;
+    iov.iov_base = &payload;
+    iov.iov_len = 1;
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    std::memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    if (recvmsg(channel, &msg, 0) != 1) {
+        return -1;
+    }
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int fd = -1;
+            std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            return fd;
+        }
+    }
+    return -1;
+}
+#endif
+
+} // namespace
+
+void HotUpgrade::installSignalHandlers() {
+#ifndef _WIN32
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onUpgradeSignal;
+    sigemptyset(&sa.sa_mask);
+    // Restart interrupted recv()/send() so an upgrade never cuts a request short;
+    // the server loop's poll() still wakes with EINTR and sees the request
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &sa, nullptr);
+
+    // A client hanging up mid-response must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+#endif
+}
+
+void HotUpgrade::resolveExecutable(const char* argv0) {
+#ifndef _WIN32
+    executablePath.clear();
+#ifdef __linux__
+    char buffer[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+    if (length > 0) {
+        executablePath.assign(buffer, static_cast<std::size_t>(length));
+        return;
+    }
+#endif
+    if (!argv0 || *argv0 == '\0') {
+        return;
+    }
+    if (std::strchr(argv0, '/')) {
+        executablePath = absolutePath(argv0);
+        return;
+    }
+
+    // A bare name was found on PATH by the shell; search it the same way
+    const char* path = std::getenv("PATH");
+    std::string directories = path ? path : "";
+    std::size_t start = 0;
+    while (start <= directories.size()) {
+        std::size_t end = directories.find(':', start);
+        if (end == std::string::npos) {
+            end = directories.size();
+        }
+        std::string directory = directories.substr(start, end - start);
+        std::string candidate = (directory.empty() ? std::string(".") : directory) + "/" + argv0;
+        if (isExecutableFile(candidate)) {
+            executablePath = absolutePath(candidate);
+            return;
+        }
+        start = end + 1;
+    }
+#else
+    (void)argv0;
+#endif
+}
+
+bool HotUpgrade::requested() {
+#ifndef _WIN32
+    return upgradeRequested != 0;
+#else
+    return false;
+#endif
+}
+
+socket_t HotUpgrade::receiveListener() {
+#ifndef _WIN32
+    const char* value = std::getenv(kHandoffEnv);
+    if (!value) {
+        return INVALID_SOCKET;
+    }
+
+    int channel = std::atoi(value);
+    unsetenv(kHandoffEnv);
+    if (channel <= 0) {
+        return INVALID_SOCKET;
+    }
+    fcntl(channel, F_SETFD, FD_CLOEXEC);
+
+    int listener = receiveDescriptor(channel);
+    if (listener < 0) {
+        std::cerr << "Failed to receive listening socket from previous process" << std::endl;
+        close(channel);
+        return INVALID_SOCKET;
+    }
+
+    fcntl(listener, F_SETFD, FD_CLOEXEC);
+    handoffChannel = channel;
+    return listener;
+#else
+    return INVALID_SOCKET;
+#endif
+}
+
+bool HotUpgrade::confirmReady(std::string& state) {
+    state.clear();
+#ifndef _WIN32
+    if (handoffChannel < 0) return false;
+
+    // The previous process is only told once this one can serve, and sends
+    // its state as a length followed by the bytes
+    bool received = false;
+    char ready = 'R';
+    std::uint64_t length = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kReadyTimeoutMs);
+    if (send(handoffChannel, &ready, 1, MSG_NOSIGNAL) != 1) {
+        std::cerr << "Failed to notify previous process: " << errno << std::endl;
+    } else if (!receiveAll(handoffChannel, reinterpret_cast<char*>(&length), sizeof(length), deadline) ||
+               length > kMaxStateBytes) {
+        std::cerr << "No state received from previous process" << std::endl;
+    } else {
+        state.resize(length);
+        received = receiveAll(handoffChannel, &state[0], state.size(), deadline);
+        if (!received) {
+            std::cerr << "State from previous process was cut short" << std::endl;
+            state.clear();
+        }
+    }
+    close(handoffChannel);
+    handoffChannel = -1;
+    return received;
+#else
+    return false;
+#endif
+}
+
+bool HotUpgrade::beginHandOff(socket_t listener, char* argv[]) {
+#ifndef _WIN32
+    upgradeRequested = 0;
+    if (pendingChannel >= 0) {
+        std::cerr << "Upgrade already in progress" << std::endl;
+        return false;
+    }
+
+    const char* binary = executablePath.empty() ? argv[0] : executablePath.c_str();
+
+    int channel[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0) {
+        std::cerr << "Upgrade failed, socketpair: " << errno << std::endl;
+        return false;
+    }
+    // Only the child end survives exec
+    fcntl(channel[0], F_SETFD, FD_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Upgrade failed, fork: " << errno << std::endl;
+        close(channel[0]);
+        close(channel[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        std::string fd = std::to_string(channel[1]);
+        setenv(kHandoffEnv, fd.c_str(), 1);
+        execv(binary, argv);
+        // Only reached if exec failed
+        _exit(127);
+    }
+
+    close(channel[1]);
+    std::cout << "Started new binary " << binary << " (pid " << pid << "), handing off listener..." << std::endl;
+
+    pendingChannel = channel[0];
+    pendingPid = pid;
+    pendingDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kReadyTimeoutMs);
+    if (!sendDescriptor(pendingChannel, listener)) {
+        std::cerr << "Upgrade failed, could not pass the listener: " << errno << std::endl;
+        endPendingHandOff(false);
+        return false;
+    }
+    return true;
+#else
+    (void)listener;
+    (void)argv;
+    return false;
+#endif
+}
+
+socket_t HotUpgrade::handOffChannel() {
+#ifndef _WIN32
+    return pendingChannel >= 0 ? pendingChannel : INVALID_SOCKET;
+#else
+    return INVALID_SOCKET;
+#endif
+}
+
+bool HotUpgrade::handOffComplete() {
+#ifndef _WIN32
+    if (pendingChannel < 0) {
+        return false;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = pendingChannel;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) == 1) {
+        // The new process either reported ready or exited (end of stream)
+        char ready = 0;
+        if (recv(pendingChannel, &ready, 1, 0) == 1 && ready == 'R') {
+            endPendingHandOff(true);
+            std::cout << "New binary is accepting connections, stopping this process" << std::endl;
+            return true;
+        }
+    } else if (std::chrono::steady_clock::now() < pendingDeadline) {
+        return false;
+    }
+
+    std::cerr << "New binary did not become ready, continuing to serve" << std::endl;
+    endPendingHandOff(false);
+    return false;
+#else
+    return false;
+#endif
+}
+
+bool HotUpgrade::sendState(std::string_view state) {
+#ifndef _WIN32
+    if (readyChannel < 0) return false;
+
+    std::uint64_t length = state.size();
+    bool sent = sendAll(readyChannel, reinterpret_cast<const char*>(&length), sizeof(length)) &&
+                sendAll(readyChannel, state.data(), state.size());
+    if (!sent) {
+        std::cerr << "Failed to pass state to the new binary: " << errno << std::endl;
+    }
+    close(readyChannel);
+    readyChannel = -1;
+    return sent;
+#else
+    (void)state;
+    return false;
+#endif
+}
@@ -0,0 +1,438 @@
+#include "../include/http_request.h"
+#include "../include/simd_scan.h"
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+// Return the next line (without CRLF/LF) and advance pos past it.
+// Returns false if no line terminator remains.
+bool nextLine(std::string_view raw, std::size_t& pos, std::string_view& line) {
+    const char* start = raw.data() + pos;
+    const char* end = raw.data() + raw.size();
+    const char* lf = simd::findByte(start, end, '\n');
+    if (lf == end) {
+        return false;
+    }
+
+    const char* lineEnd = lf;
+    if (lineEnd > start && lineEnd[-1] == '\r') {
+        lineEnd--;
+    }
+    line = std::string_view(start, lineEnd - start);
+    pos = (lf - raw.data()) + 1;
+    return true;
+}
+
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+char toLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// Offset of the first c in text, or npos
+std::size_t scan(std::string_view text, char c) {
+    const char* end = text.data() + text.size();
+    const char* hit = simd::findByte(text.data(), end, c);
+    return hit == end ? std::string_view::npos : static_cast<std::size_t>(hit - text.data());
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode one character of a form-encoded string at text[i], advancing i.
+// Malformed escapes are taken literally.
+char decodeNext(std::string_view text, std::size_t& i) {
+    char c = text[i++];
+    if (c == '+') {
+        return ' ';
+    }
+    if (c == '%' && i + 1 < text.size()) {
+        int hi = hexValue(text[i]);
+        int lo = hexValue(text[i + 1]);
+        if (hi >= 0 && lo >= 0) {
+            i += 2;
+            return static_cast<char>((hi << 4) | lo);
+        }
+    }
+    return c;
+}
+
+bool needsDecoding(std::string_view text) {
+    const char* end = text.data() + text.size();
+    return simd::findEither(text.data(), end, '%', '+') != end;
+}
+
+// Compare an encoded string against a plain one without decoding it first
+bool decodedEquals(std::string_view encoded, std::string_view plain) {
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < encoded.size()) {
+        if (j == plain.size() || decodeNext(encoded, i) != plain[j++]) {
+            return false;
+        }
+    }
+    return j == plain.size();
+}
+
+// True if the last transfer coding is "chunked"
+bool isChunked(std::string_view transferEncoding) {
+    std::size_t comma = transferEncoding.rfind(',');
+    std::string_view last = (comma == std::string_view::npos) ? transferEncoding : transferEncoding.substr(comma + 1);
+    return equalsIgnoreCase(trim(last), "chunked");
+}
+
+// Decode a chunked body starting at data[pos]. The chunk framing is first
+// checked for completeness without touching the buffer; once the last chunk
+// and trailers are present the payloads are moved down over the framing.
+ParseResult decodeChunkedBody(char* data, std::size_t size, std::size_t pos, std::string_view& body, std::size_t maxBody) {
+    std::string_view raw(data, size);
+    std::size_t scan = pos;
+    std::size_t total = 0;
+    std::string_view line;
+
+    for (;;) {
+        if (!nextLine(raw, scan, line)) {
+            return ParseResult::Incomplete;
+        }
+        // Chunk extensions after ';' are ignored
+        std::string_view sizeField = trim(line.substr(0, line.find(';')));
+        std::size_t chunkSize = 0;
+        auto result = std::from_chars(sizeField.data(), sizeField.data() + sizeField.size(), chunkSize, 16);
+        if (sizeField.empty() || result.ec != std::errc() || result.ptr != sizeField.data() + sizeField.size()) {
+            return ParseResult::Invalid;
+        }
+        if (chunkSize == 0) {
+            break;
+        }
+        if (chunkSize > maxBody) {
+            return ParseResult::BodyTooLarge;
+        }
+        if (size - scan < chunkSize + 2) {
+            return ParseResult::Incomplete;
+        }
+        if (data[scan + chunkSize] != '\r' || data[scan + chunkSize + 1] != '\n') {
+            return ParseResult::Invalid;
+        }
+        total += chunkSize;
+        if (total > maxBody) {
+            return ParseResult::BodyTooLarge;
+        }
+        scan += chunkSize + 2;
+    }
+
+    // Trailer section ends with an empty line
+    do {
+        if (!nextLine(raw, scan, line)) {
+            return ParseResult::Incomplete;
+        }
+    } while (!line.empty());
+
+    // Complete: compact the payloads
+    std::size_t read = pos;
+    std::size_t write = pos;
+    for (;;) {
+        nextLine(raw, read, line);
+        std::size_t chunkSize = 0;
+        std::string_view sizeField = trim(line.substr(0, line.find(';')));
+        std::from_chars(sizeField.data(), sizeField.data() + sizeField.size(), chunkSize, 16);
+        if (chunkSize == 0) {
+            break;
+        }
+        std::memmove(data + write, data + read, chunkSize);
+        write += chunkSize;
+        read += chunkSize + 2;
+    }
+
+    body = std::string_view(data + pos, total);
+    return ParseResult::Ok;
+}
+
+std::size_t envSize(const char* name, std::size_t fallback) {
+    const char* value = std::getenv(name);
+    std::size_t parsed = 0;
+    if (value && parseInteger(std::string_view(value), parsed) && parsed > 0) {
+        return parsed;
+    }
+    return fallback;
+}
+
+std::atomic<std::size_t> bufferBudgetUsed{0};
+
+} // namespace
+
+HttpLimits HttpLimits::fromEnvironment() {
+    HttpLimits limits;
+    limits.maxHeaderBytes = envSize("NGG_MAX_HEADER_BYTES", limits.maxHeaderBytes);
+    limits.maxHeaderCount = envSize("NGG_MAX_HEADER_COUNT", limits.maxHeaderCount);
+    limits.maxBodyBytes = envSize("NGG_MAX_BODY_BYTES", limits.maxBodyBytes);
+    limits.bufferBudgetBytes = envSize("NGG_REQUEST_BUFFER_BUDGET", limits.bufferBudgetBytes);
+    limits.requestTimeoutMillis = envSize("NGG_REQUEST_TIMEOUT_MS", limits.requestTimeoutMillis);
+    return limits;
+}
+
+RequestBuffer::RequestBuffer(const HttpLimits& limits) : limits(limits) {}
+
+RequestBuffer::~RequestBuffer() {
+    if (heap) {
+        delete[] heap;
+        bufferBudgetUsed -= heapCapacity;
+    }
+}
+
+RequestBuffer::GrowResult RequestBuffer::grow(std::size_t wanted) {
+    if (wanted <= capacity()) {
+        return GrowResult::Ok;
+    }
+    if (wanted > limits.maxRequestBytes()) {
+        return GrowResult::TooLarge;
+    }
+
+    // Charge the whole new block before allocating; the old one is released after
+    std::size_t charged = bufferBudgetUsed.fetch_add(wanted) + wanted;
+    if (charged - heapCapacity > limits.bufferBudgetBytes) {
+        bufferBudgetUsed -= wanted;
+        return GrowResult::OverBudget;
+    }
+
+    char* block = new (std::nothrow) char[wanted];
+    if (!block) {
+        bufferBudgetUsed -= wanted;
+        return GrowResult::OverBudget;
+    }
+    std::memcpy(block, data(), used);
+    if (heap) {
+        delete[] heap;
+        bufferBudgetUsed -= heapCapacity;
+    }
+    heap = block;
+    heapCapacity = wanted;
+    return GrowResult::Ok;
+}
+
+std::size_t RequestBuffer::budgetInUse() {
+    return bufferBudgetUsed.load();
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (toLowerAscii(a[i]) != toLowerAscii(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HeaderTable::clear() {
+    count = 0;
+    overflow.clear();
+    for (auto& slot : known) {
+        slot = std::string_view();
+    }
+}
+
+void HeaderTable::add(std::string_view name, std::string_view value) {
+    if (count < kCapacity) {
+        entries[count].name = name;
+        entries[count].value = value;
+        count++;
+    } else {
+        overflow.push_back(HttpHeader{name, value});
+    }
+
+    // Every known header name has a distinct length, so one compare decides it
+    int slot = -1;
+    switch (name.size()) {
+        case 14: if (equalsIgnoreCase(name, "Content-Length")) slot = static_cast<int>(KnownHeader::ContentLength); break;
+        case 10: if (equalsIgnoreCase(name, "Connection")) slot = static_cast<int>(KnownHeader::Connection); break;
+        case 15: if (equalsIgnoreCase(name, "Accept-Encoding")) slot = static_cast<int>(KnownHeader::AcceptEncoding); break;
+        case 13: if (equalsIgnoreCase(name, "If-None-Match")) slot = static_cast<int>(KnownHeader::IfNoneMatch); break;
+        case 17: if (equalsIgnoreCase(name, "Transfer-Encoding")) slot = static_cast<int>(KnownHeader::TransferEncoding); break;
+        case 6: if (equalsIgnoreCase(name, "Accept")) slot = static_cast<int>(KnownHeader::Accept); break;
+        case 12: if (equalsIgnoreCase(name, "Content-Type")) slot = static_cast<int>(KnownHeader::ContentType); break;
+        default: break;
+    }
+    if (slot >= 0) {
+        known[slot] = value;
+    }
+}
+
+std::string_view HeaderTable::get(std::string_view name) const {
+    for (std::size_t i = 0; i < size(); i++) {
+        if (equalsIgnoreCase((*this)[i].name, name)) {
+            return (*this)[i].value;
+        }
+    }
+    return std::string_view();
+}
+
+bool HeaderTable::has(std::string_view name) const {
+    for (std::size_t i = 0; i < size(); i++) {
+        if (equalsIgnoreCase((*this)[i].name, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QueryResult HttpRequest::queryParam(std::string_view key, std::string_view& value) const {
+    const char* p = query.data();
+    const char* end = p + query.size();
+    while (p < end) {
+        const char* sep = simd::findEither(p, end, '&', '=');
+        if (sep == end) {
+            break;
+        }
+        if (*sep == '&') {
+            // Parameter without '=' carries no value
+            p = sep + 1;
+            continue;
+        }
+
+        const char* valueEnd = simd::findByte(sep + 1, end, '&');
+        std::string_view name(p, sep - p);
+        if (name == key || (needsDecoding(name) && decodedEquals(name, key))) {
+            std::string_view raw(sep + 1, valueEnd - (sep + 1));
+            if (!needsDecoding(raw)) {
+                value = raw;
+                return QueryResult::Found;
+            }
+
+            // Decoded text is never longer than the encoded text
+            if (raw.size() > kScratchSize - scratchUsed) {
+                return QueryResult::TooLong;
+            }
+            char* out = scratch + scratchUsed;
+            std::size_t length = 0;
+            for (std::size_t i = 0; i < raw.size();) {
+                out[length++] = decodeNext(raw, i);
+            }
+            scratchUsed += length;
+            value = std::string_view(out, length);
+            return QueryResult::Found;
+        }
+        p = (valueEnd == end) ? end : valueEnd + 1;
+    }
+    return QueryResult::Missing;
+}
+
+QueryResult HttpRequest::queryInt(std::string_view key, int& value) const {
+    std::string_view text;
+    QueryResult result = queryParam(key, text);
+    if (result == QueryResult::Found && !parseInteger(text, value)) {
+        return QueryResult::Invalid;
+    }
+    return result;
+}
+
+ParseResult parseHttpRequest(char* data, std::size_t size, HttpRequest& request, const HttpLimits& limits) {
+    std::string_view raw(data, size);
+    std::size_t pos = 0;
+    std::string_view line;
+    request.expectedSize = 0;
+
+    // Only the header section is scanned until it is known to fit the limit
+    std::string_view headerArea = raw.substr(0, limits.maxHeaderBytes);
+    ParseResult unterminated = raw.size() > limits.maxHeaderBytes ? ParseResult::HeadersTooLarge : ParseResult::Incomplete;
+
+    // Parse request line: METHOD SP TARGET SP VERSION
+    if (!nextLine(headerArea, pos, line)) {
+        return unterminated;
+    }
+
+    std::size_t methodEnd = scan(line, ' ');
+    if (methodEnd == std::string_view::npos || methodEnd == 0) {
+        return ParseResult::Invalid;
+    }
+    request.method = line.substr(0, methodEnd);
+
+    std::string_view target = line.substr(methodEnd + 1);
+    target = target.substr(0, scan(target, ' '));
+    if (target.empty()) {
+        return ParseResult::Invalid;
+    }
+
+    // Split path and query string
+    std::size_t queryPos = scan(target, '?');
+    if (queryPos != std::string_view::npos) {
+        request.path = target.substr(0, queryPos);
+        request.query = target.substr(queryPos + 1);
+    } else {
+        request.path = target;
+        request.query = std::string_view();
+    }
+
+    // Parse headers up to the empty line
+    request.headers.clear();
+    request.reset();
+    bool headersDone = false;
+    while (nextLine(headerArea, pos, line)) {
+        if (line.empty()) {
+            headersDone = true;
+            break;
+        }
+
+        std::size_t colon = scan(line, ':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        if (request.headers.size() >= limits.maxHeaderCount) {
+            return ParseResult::HeadersTooLarge;
+        }
+        request.headers.add(line.substr(0, colon), trim(line.substr(colon + 1)));
+    }
+    if (!headersDone) {
+        return unterminated;
+    }
+
+    request.body = std::string_view();
+    if (request.headers.has(KnownHeader::TransferEncoding)) {
+        if (!isChunked(request.headers.get(KnownHeader::TransferEncoding))) {
+            return ParseResult::Invalid;
+        }
+        ParseResult result = decodeChunkedBody(data, size, pos, request.body, limits.maxBodyBytes);
+        if (result == ParseResult::Incomplete && size >= limits.maxRequestBytes()) {
+            // Framing overhead alone has filled the largest buffer we allow
+            return ParseResult::BodyTooLarge;
+        }
+        return result;
+    }
+
+    // Otherwise the body is whatever Content-Length covers
+    if (request.headers.has(KnownHeader::ContentLength)) {
+        std::string_view lengthValue = request.headers.get(KnownHeader::ContentLength);
+        std::size_t contentLength = 0;
+        auto result = std::from_chars(lengthValue.data(), lengthValue.data() + lengthValue.size(), contentLength);
+        if (result.ec != std::errc() || result.ptr != lengthValue.data() + lengthValue.size()) {
+            return ParseResult::Invalid;
+        }
+        if (contentLength > limits.maxBodyBytes) {
+            return ParseResult::BodyTooLarge;
+        }
+        if (raw.size() - pos < contentLength) {
+            request.expectedSize = pos + contentLength;
+            return ParseResult::Incomplete;
+        }
+        request.body = raw.substr(pos, contentLength);
+    }
+
+    return ParseResult::Ok;
+}
@@ -0,0 +1,343 @@
+#include "../include/http_response.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Prebuilt header blocks, up to (not including) the Date line
+// API bodies are negotiated on Accept, hence Vary
+constexpr std::string_view kJsonHead =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/json\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Vary: Accept\r\n";
+
+constexpr std::string_view kMessagePackHead =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/msgpack\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Vary: Accept\r\n";
+
+constexpr std::string_view kCborHead =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/cbor\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Vary: Accept\r\n";
+
+constexpr std::string_view kHtmlHead =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/html\r\n";
+
+constexpr std::string_view kCssHead =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/css\r\n";
+
+// Server-Sent Events: no length, the body runs until the connection closes
+constexpr std::string_view kEventStreamHead =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n";
+
+constexpr std::string_view kContentLength = "Content-Length: ";
+constexpr std::string_view kChunkedEncoding = "Transfer-Encoding: chunked\r\n\r\n";
+
+// Chunk sizes are written as fixed-width hex so the field can be reserved
+// before the payload and patched afterwards; leading zeros are allowed
+constexpr std::size_t kChunkSizeDigits = 8;
+constexpr std::string_view kChunkSizePlaceholder = "00000000\r\n";
+constexpr std::string_view kLastChunk = "0\r\n\r\n";
+
+// Error responses are fully static apart from the Date line between head and tail
+struct StaticError {
+    std::string_view head;
+    std::string_view tail;
+};
+
+#define STATIC_ERROR(status, length, title) \
+    StaticError{"HTTP/1.1 " status "\r\nContent-Type: text/html\r\nContent-Length: " #length "\r\n", \
+                "\r\n<html><body><h1>" title "</h1></body></html>"}
+
+constexpr StaticError kErrors[] = {
+    STATIC_ERROR("400 Bad Request", 50, "400 Bad Request"),
+    STATIC_ERROR("404 Not Found", 48, "404 Not Found"),
+    STATIC_ERROR("408 Request Timeout", 54, "408 Request Timeout"),
+    STATIC_ERROR("413 Payload Too Large", 56, "413 Payload Too Large"),
+    STATIC_ERROR("431 Request Header Fields Too Large", 70, "431 Request Header Fields Too Large"),
+    STATIC_ERROR("503 Service Unavailable", 58, "503 Service Unavailable"),
+};
+
+#undef STATIC_ERROR
+
+constexpr bool contentLengthMatches(const StaticError& error) {
+    std::size_t start = error.head.find("Content-Length: ") + 16;
+    std::size_t length = 0;
+    for (std::size_t i = start; error.head[i] != '\r'; i++) {
+        length = length * 10 + (error.head[i] - '0');
+    }
+    return length == error.tail.size() - 2;
+}
+
+constexpr bool allContentLengthsMatch() {
+    for (const StaticError& error : kErrors) {
+        if (!contentLengthMatches(error)) return false;
+    }
+    return true;
+}
+static_assert(allContentLengthsMatch(), "static error Content-Length is out of date");
+
+// "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+constexpr std::size_t kDateLineLength = 37;
+char dateLine[kDateLineLength + 1] = "Date: Thu, 01 Jan 1970 00:00:00 GMT\r\n";
+std::time_t dateSecond = -1;
+
+void putTwoDigits(char* p, int value) {
+    p[0] = static_cast<char>('0' + value / 10);
+    p[1] = static_cast<char>('0' + value % 10);
+}
+
+std::string_view headFor(ContentKind kind) {
+    switch (kind) {
+        case ContentKind::Json: return kJsonHead;
+        case ContentKind::Html: return kHtmlHead;
+        case ContentKind::Css: return kCssHead;
+        case ContentKind::MessagePack: return kMessagePackHead;
+        case ContentKind::Cbor: return kCborHead;
+    }
+    return kJsonHead;
+}
+
+// Longest possible header block: head, Date, Content-Length and blank line
+constexpr std::size_t kMaxHeadSize =
+    std::max({kJsonHead.size(), kHtmlHead.size(), kCssHead.size(),
+              kMessagePackHead.size(), kCborHead.size()}) +
+    kDateLineLength + kContentLength.size() + 20 + 4;
+
+// Format the full header block for a body of bodySize bytes into out
+std::size_t formatHead(char* out, ContentKind kind, std::size_t bodySize) {
+    std::string_view head = headFor(kind);
+    char* p = out;
+    std::memcpy(p, head.data(), head.size());
+    p += head.size();
+    std::string_view date = HttpDate::line();
+    std::memcpy(p, date.data(), date.size());
+    p += date.size();
+    std::memcpy(p, kContentLength.data(), kContentLength.size());
+    p += kContentLength.size();
+    p = std::to_chars(p, p + 20, bodySize).ptr;
+    std::memcpy(p, "\r\n\r\n", 4);
+    return (p + 4) - out;
+}
+
+
+} // namespace
+
+void HttpDate::refresh(std::time_t now) {
+    if (now == dateSecond) {
+        return;
+    }
+    dateSecond = now;
+
+    static const char* const days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char* const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                         "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    std::tm tm;
+#ifdef _WIN32
+    gmtime_s(&tm, &now);
+#else
+    gmtime_r(&now, &tm);
+#endif
+
+    char* p = dateLine + 6;
+    std::copy(days[tm.tm_wday], days[tm.tm_wday] + 3, p);
+    putTwoDigits(p + 5, tm.tm_mday);
+    std::copy(months[tm.tm_mon], months[tm.tm_mon] + 3, p + 8);
+    int year = tm.tm_year + 1900;
+    putTwoDigits(p + 12, year / 100);
+    putTwoDigits(p + 14, year % 100);
+    putTwoDigits(p + 17, tm.tm_hour);
+    putTwoDigits(p + 20, tm.tm_min);
+    putTwoDigits(p + 23, tm.tm_sec);
+}
+
+std::string_view HttpDate::line() {
+    if (dateSecond < 0) {
+        refresh();
+    }
+    return std::string_view(dateLine, kDateLineLength);
+}
+
+void writeResponse(std::string& out, ContentKind kind, std::string_view body) {
+    char head[kMaxHeadSize];
+    std::size_t headSize = formatHead(head, kind, body.size());
+
+    out.clear();
+    out.reserve(headSize + body.size());
+    out.append(head, headSize);
+    out.append(body);
+}
+
+void writeError(std::string& out, HttpError error) {
+    const StaticError& response = kErrors[static_cast<std::size_t>(error)];
+    out.clear();
+    out.append(response.head);
+    out.append(HttpDate::line());
+    out.append(response.tail);
+}
+
+HttpResponse::HttpResponse(socket_t socket, std::string& buffer)
+    : socket(socket), buffer(buffer) {
+    buffer.clear();
+}
+
+void HttpResponse::send(ContentKind kind, std::string_view body) {
+    if (started()) {
+        std::cerr << "Response already streaming, dropping replacement body" << std::endl;
+        return;
+    }
+    chunked = false;
+    sendOffset = 0;
+    writeResponse(buffer, kind, body);
+}
+
+ContentKind HttpResponse::formatKind() const {
+    switch (negotiated) {
+        case WireFormat::Json: return ContentKind::Json;
+        case WireFormat::MessagePack: return ContentKind::MessagePack;
+        case WireFormat::Cbor: return ContentKind::Cbor;
+    }
+    return ContentKind::Json;
+}
+
+std::string& HttpResponse::beginBody(ContentKind kind) {
+    chunked = false;
+    sendOffset = 0;
+    bodyKind = kind;
+    buffer.assign(kMaxHeadSize, ' ');
+    return buffer;
+}
+
+void HttpResponse::endBody() {
+    if (started() || buffer.size() < kMaxHeadSize) {
+        return;
+    }
+    char head[kMaxHeadSize];
+    std::size_t headSize = formatHead(head, bodyKind, buffer.size() - kMaxHeadSize);
+    // Right-align the headers against the body and send from there
+    sendOffset = kMaxHeadSize - headSize;
+    std::memcpy(&buffer[sendOffset], head, headSize);
+}
+
+void HttpResponse::error(HttpError error) {
+    if (started()) return;
+    chunked = false;
+    sendOffset = 0;
+    writeError(buffer, error);
+}
+
+void HttpResponse::beginChunked(ContentKind kind) {
+    sendOffset = 0;
+    buffer.clear();
+    buffer.append(headFor(kind));
+    buffer.append(HttpDate::line());
+    buffer.append(kChunkedEncoding);
+    chunked = true;
+    openChunk();
+}
+
+void HttpResponse::write(std::string_view data) {
+    buffer.append(data);
+    flushIfFull();
+}
+
+void HttpResponse::flushIfFull() {
+    if (!chunked || buffer.size() - chunkStart < kChunkSize) {
+        return;
+    }
+    closeChunk();
+    sendBuffer();
+    buffer.clear();
+    openChunk();
+}
+
+void HttpResponse::endChunked() {
+    if (!chunked) return;
+    closeChunk();
+    buffer.append(kLastChunk);
+    chunked = false;
+}
+
+bool HttpResponse::startEventStream() {
+    if (started()) return false;
+    chunked = false;
+    sendOffset = 0;
+    buffer.clear();
+    buffer.append(kEventStreamHead);
+    buffer.append(HttpDate::line());
+    buffer.append("\r\n", 2);
+    if (!sendBuffer()) {
+        return false;
+    }
+    buffer.clear();
+    eventStream = true;
+    return true;
+}
+
+bool HttpResponse::finish() {
+    if (eventStream) {
+        return true;
+    }
+    if (chunked) {
+        endChunked();
+    }
+    return sendBuffer();
+}
+
+void HttpResponse::openChunk() {
+    chunkStart = buffer.size();
+    buffer.append(kChunkSizePlaceholder);
+}
+
+void HttpResponse::closeChunk() {
+    std::size_t payload = buffer.size() - chunkStart - kChunkSizePlaceholder.size();
+    if (payload == 0) {
+        // Drop the empty chunk; a zero size would end the body early
+        buffer.resize(chunkStart);
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    char* field = &buffer[chunkStart];
+    for (std::size_t i = 0; i < kChunkSizeDigits; i++) {
+        field[kChunkSizeDigits - 1 - i] = hex[(payload >> (4 * i)) & 0xF];
+    }
+    buffer.append("\r\n", 2);
+}
+
+bool HttpResponse::sendBuffer() {
+    if (failed) {
+        return false;
+    }
+
+    const char* data = buffer.data() + sendOffset;
+    std::size_t remaining = buffer.size() - sendOffset;
+    while (remaining > 0) {
+#ifdef MSG_NOSIGNAL
+        int n = ::send(socket, data, static_cast<int>(remaining), MSG_NOSIGNAL);
+#else
+        int n = ::send(socket, data, static_cast<int>(remaining), 0);
+#endif
+        if (n <= 0) {
+            std::cerr << "Failed to send response: " << SOCKET_ERROR_CODE << std::endl;
+            failed = true;
+            return false;
+        }
+        data += n;
+        remaining -= n;
+        bytesSent += n;
+    }
+    return true;
+}
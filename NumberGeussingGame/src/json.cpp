@@ -0,0 +1,763 @@
+#include "../include/json.h"
+#include "../include/json_structural.h"
+#include "../include/simd_scan.h"
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void skipSpace(std::string_view json, std::size_t& pos) {
+    while (pos < json.size() && isSpace(json[pos])) {
+        pos++;
+    }
+}
+
+// Scan a string whose opening quote is at json[pos]. On success pos is past
+// the closing quote and contents/escaped describe the text between quotes.
+bool scanString(std::string_view json, std::size_t& pos, std::string_view& contents, bool& escaped) {
+    const char* begin = json.data() + pos + 1;
+    const char* end = json.data() + json.size();
+    const char* p = begin;
+    escaped = false;
+
+    for (;;) {
+        p = simd::findEither(p, end, '"', '\\');
+        if (p == end) {
+            return false;
+        }
+        if (*p == '"') {
+            break;
+        }
+        // Backslash: skip it and the escaped character
+        escaped = true;
+        p += 2;
+        if (p > end) {
+            return false;
+        }
+    }
+
+    contents = std::string_view(begin, p - begin);
+    pos = (p - json.data()) + 1;
+    return true;
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+void skipDigits(std::string_view json, std::size_t& pos) {
+    while (pos < json.size() && isDigit(json[pos])) {
+        pos++;
+    }
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool scanNumber(std::string_view json, std::size_t& pos) {
+    if (pos < json.size() && json[pos] == '-') {
+        pos++;
+    }
+    if (pos >= json.size() || !isDigit(json[pos])) {
+        return false;
+    }
+    if (json[pos++] != '0') {
+        skipDigits(json, pos);
+    }
+    if (pos < json.size() && json[pos] == '.') {
+        pos++;
+        if (pos >= json.size() || !isDigit(json[pos])) {
+            return false;
+        }
+        skipDigits(json, pos);
+    }
+    if (pos < json.size() && (json[pos] == 'e' || json[pos] == 'E')) {
+        pos++;
+        if (pos < json.size() && (json[pos] == '+' || json[pos] == '-')) {
+            pos++;
+        }
+        if (pos >= json.size() || !isDigit(json[pos])) {
+            return false;
+        }
+        skipDigits(json, pos);
+    }
+    return true;
+}
+
+bool scanLiteral(std::string_view json, std::size_t& pos, std::string_view literal) {
+    if (json.substr(pos, literal.size()) != literal) {
+        return false;
+    }
+    pos += literal.size();
+    return true;
+}
+
+// Number, true, false or null starting at json[pos]
+bool scanScalar(std::string_view json, std::size_t& pos, JsonType& type) {
+    if (pos >= json.size()) {
+        return false;
+    }
+    char c = json[pos];
+    if (c == '-' || isDigit(c)) {
+        type = JsonType::Number;
+        return scanNumber(json, pos);
+    }
+    if (scanLiteral(json, pos, "true") || scanLiteral(json, pos, "false")) {
+        type = JsonType::Boolean;
+        return true;
+    }
+    type = JsonType::Null;
+    return scanLiteral(json, pos, "null");
+}
+
+// Nesting deeper than this is rejected
+constexpr int kMaxNesting = 128;
+
+// Grammar of a nested object or array, fed one token at a time.
+// Both readers drive the same checks, so a document is accepted or rejected
+// the same way whichever reader it goes to.
+class ContainerGrammar {
+public:
+    bool open(bool object) {
+        if ((depth > 0 && !expectingValue()) || depth == kMaxNesting) {
+            return false;
+        }
+        isObject[depth++] = object;
+        expect = object ? Expect::KeyOrClose : Expect::ValueOrClose;
+        return true;
+    }
+
+    bool close(bool object) {
+        if (depth == 0 || isObject[depth - 1] != object) {
+            return false;
+        }
+        Expect empty = object ? Expect::KeyOrClose : Expect::ValueOrClose;
+        if (expect != Expect::CommaOrClose && expect != empty) {
+            return false;
+        }
+        depth--;
+        expect = Expect::CommaOrClose;
+        return true;
+    }
+
+    // A string is a key where one is expected, otherwise a value
+    bool string() {
+        if (expect == Expect::Key || expect == Expect::KeyOrClose) {
+            expect = Expect::Colon;
+            return true;
+        }
+        return value();
+    }
+
+    bool value() {
+        if (depth == 0 || !expectingValue()) {
+            return false;
+        }
+        expect = Expect::CommaOrClose;
+        return true;
+    }
+
+    bool colon() {
+        if (expect != Expect::Colon) {
+            return false;
+        }
+        expect = Expect::Value;
+        return true;
+    }
+
+    bool comma() {
+        if (depth == 0 || expect != Expect::CommaOrClose) {
+            return false;
+        }
+        expect = isObject[depth - 1] ? Expect::Key : Expect::Value;
+        return true;
+    }
+
+    // The outermost container has been closed
+    bool done() const { return depth == 0; }
+
+private:
+    enum class Expect {
+        KeyOrClose,
+        Key,
+        Colon,
+        Value,
+        ValueOrClose,
+        CommaOrClose
+    };
+
+    bool isObject[kMaxNesting];
+    int depth = 0;
+    Expect expect = Expect::Value;
+
+    bool expectingValue() const { return expect == Expect::Value || expect == Expect::ValueOrClose; }
+};
+
+// Check a nested object or array starting at json[pos] against the grammar;
+// on success pos is past its closing bracket
+bool scanContainer(std::string_view json, std::size_t& pos) {
+    ContainerGrammar grammar;
+    for (;;) {
+        skipSpace(json, pos);
+        if (pos >= json.size()) {
+            return false;
+        }
+        char c = json[pos];
+        bool ok;
+        switch (c) {
+            case '{':
+            case '[':
+                ok = grammar.open(c == '{');
+                pos++;
+                break;
+            case '}':
+            case ']':
+                ok = grammar.close(c == '}');
+                pos++;
+                if (ok && grammar.done()) {
+                    return true;
+                }
+                break;
+            case ':':
+                ok = grammar.colon();
+                pos++;
+                break;
+            case ',':
+                ok = grammar.comma();
+                pos++;
+                break;
+            case '"': {
+                std::string_view contents;
+                bool escaped;
+                ok = scanString(json, pos, contents, escaped) && grammar.string();
+                break;
+            }
+            default: {
+                JsonType type;
+                ok = scanScalar(json, pos, type) && grammar.value();
+                break;
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+bool scanValue(std::string_view json, std::size_t& pos, JsonValue& value) {
+    if (pos >= json.size()) {
+        return false;
+    }
+
+    std::size_t start = pos;
+    char c = json[pos];
+    if (c == '"') {
+        std::string_view contents;
+        bool escaped;
+        if (!scanString(json, pos, contents, escaped)) {
+            return false;
+        }
+        value = JsonValue(JsonType::String, contents, escaped);
+        return true;
+    }
+    if (c == '{' || c == '[') {
+        if (!scanContainer(json, pos)) {
+            return false;
+        }
+        value = JsonValue(c == '{' ? JsonType::Object : JsonType::Array, json.substr(start, pos - start), false);
+        return true;
+    }
+    JsonType type;
+    if (!scanScalar(json, pos, type)) {
+        return false;
+    }
+    value = JsonValue(type, json.substr(start, pos - start), false);
+    return true;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool readHex4(std::string_view text, std::size_t pos, unsigned& out) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    out = 0;
+    for (std::size_t i = 0; i < 4; i++) {
+        int digit = hexDigit(text[pos + i]);
+        if (digit < 0) return false;
+        out = (out << 4) | static_cast<unsigned>(digit);
+    }
+    return true;
+}
+
+// Decode escaped string text, handing each output byte to sink.
+// Returns false on a malformed escape.
+template <typename Sink>
+bool decodeString(std::string_view text, Sink&& sink) {
+    for (std::size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c != '\\') {
+            if (!sink(c)) return false;
+            continue;
+        }
+        if (++i >= text.size()) {
+            return false;
+        }
+        char decoded;
+        switch (text[i]) {
+            case '"': decoded = '"'; break;
+            case '\\': decoded = '\\'; break;
+            case '/': decoded = '/'; break;
+            case 'b': decoded = '\b'; break;
+            case 'f': decoded = '\f'; break;
+            case 'n': decoded = '\n'; break;
+            case 'r': decoded = '\r'; break;
+            case 't': decoded = '\t'; break;
+            case 'u': {
+                unsigned code;
+                if (!readHex4(text, i + 1, code)) return false;
+                i += 4;
+                // Combine a UTF-16 surrogate pair
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    unsigned low;
+                    if (i + 2 >= text.size() || text[i + 1] != '\\' || text[i + 2] != 'u' ||
+                        !readHex4(text, i + 3, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    i += 6;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                // Emit UTF-8
+                if (code < 0x80) {
+                    if (!sink(static_cast<char>(code))) return false;
+                } else if (code < 0x800) {
+                    if (!sink(static_cast<char>(0xC0 | (code >> 6)))) return false;
+                    if (!sink(static_cast<char>(0x80 | (code & 0x3F)))) return false;
+                } else if (code < 0x10000) {
+                    if (!sink(static_cast<char>(0xE0 | (code >> 12)))) return false;
+                    if (!sink(static_cast<char>(0x80 | ((code >> 6) & 0x3F)))) return false;
+                    if (!sink(static_cast<char>(0x80 | (code & 0x3F)))) return false;
+                } else {
+                    if (!sink(static_cast<char>(0xF0 | (code >> 18)))) return false;
+                    if (!sink(static_cast<char>(0x80 | ((code >> 12) & 0x3F)))) return false;
+                    if (!sink(static_cast<char>(0x80 | ((code >> 6) & 0x3F)))) return false;
+                    if (!sink(static_cast<char>(0x80 | (code & 0x3F)))) return false;
+                }
+                continue;
+            }
+            default:
+                return false;
+        }
+        if (!sink(decoded)) return false;
+    }
+    return true;
+}
+
+bool decodedEquals(std::string_view text, bool escaped, std::string_view plain) {
+    if (!escaped) {
+        return text == plain;
+    }
+    std::size_t j = 0;
+    bool ok = decodeString(text, [&](char c) {
+        return j < plain.size() && plain[j++] == c;
+    });
+    return ok && j == plain.size();
+}
+
+template <typename T>
+bool parseWhole(std::string_view text, T& out) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, out);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+} // namespace
+
+JsonValue JsonValue::fromInteger(std::int64_t value) {
+    JsonValue result(JsonType::Number, std::string_view(), false);
+    result.form = NumberForm::Integer;
+    result.integer = value;
+    return result;
+}
+
+JsonValue JsonValue::fromReal(double value) {
+    JsonValue result(JsonType::Number, std::string_view(), false);
+    result.form = NumberForm::Real;
+    result.real = value;
+    return result;
+}
+
+bool JsonValue::asInt64(std::int64_t& out) const {
+    if (valueType == JsonType::String) {
+        return !hasEscapes && parseWhole(text, out);
+    }
+    if (valueType != JsonType::Number) {
+        return false;
+    }
+    if (form == NumberForm::Integer) {
+        out = integer;
+        return true;
+    }
+    double value = real;
+    if (form == NumberForm::Text) {
+        if (parseWhole(text, out)) {
+            return true;
+        }
+        if (!parseWhole(text, value)) {
+            return false;
+        }
+    }
+    // Fractional or exponent form: truncate like a C cast, if it fits
+    if (value != value ||
+        value < static_cast<double>(std::numeric_limits<std::int64_t>::min()) ||
+        value >= static_cast<double>(std::numeric_limits<std::int64_t>::max())) {
+        return false;
+    }
+    out = static_cast<std::int64_t>(value);
+    return true;
+}
+
+bool JsonValue::asInt(int& out) const {
+    std::int64_t wide;
+    if (!asInt64(wide) || wide < std::numeric_limits<int>::min() || wide > std::numeric_limits<int>::max()) {
+        return false;
+    }
+    out = static_cast<int>(wide);
+    return true;
+}
+
+bool JsonValue::asDouble(double& out) const {
+    if (valueType == JsonType::Number && form != NumberForm::Text) {
+        out = form == NumberForm::Integer ? static_cast<double>(integer) : real;
+        return true;
+    }
+    if (valueType == JsonType::Number || (valueType == JsonType::String && !hasEscapes)) {
+        return parseWhole(text, out);
+    }
+    return false;
+}
+
+bool JsonValue::asBool(bool& out) const {
+    if (valueType != JsonType::Boolean) {
+        return false;
+    }
+    out = text.size() == 4;    // "true"
+    return true;
+}
+
+bool JsonValue::asString(std::string& out) const {
+    if (valueType != JsonType::String) {
+        return false;
+    }
+    if (!hasEscapes) {
+        out.append(text);
+        return true;
+    }
+    return decodeString(text, [&out](char c) {
+        out.push_back(c);
+        return true;
+    });
+}
+
+bool JsonValue::equals(std::string_view plain) const {
+    return valueType == JsonType::String && decodedEquals(text, hasEscapes, plain);
+}
+
+bool JsonField::keyEquals(std::string_view plain) const {
+    return decodedEquals(key, keyEscaped, plain);
+}
+
+bool JsonReader::next(JsonField& field) {
+    if (failed || finished) {
+        return false;
+    }
+
+    if (!started) {
+        started = true;
+        skipSpace(json, pos);
+        if (pos >= json.size() || json[pos] != '{') {
+            return fail();
+        }
+        pos++;
+        skipSpace(json, pos);
+        if (pos < json.size() && json[pos] == '}') {
+            return finish();
+        }
+    } else {
+        // Between members: ',' continues, '}' ends the object
+        skipSpace(json, pos);
+        if (pos < json.size() && json[pos] == '}') {
+            return finish();
+        }
+        if (pos >= json.size() || json[pos] != ',') {
+            return fail();
+        }
+        pos++;
+        skipSpace(json, pos);
+    }
+
+    if (pos >= json.size() || json[pos] != '"') {
+        return fail();
+    }
+    if (!scanString(json, pos, field.key, field.keyEscaped)) {
+        return fail();
+    }
+
+    skipSpace(json, pos);
+    if (pos >= json.size() || json[pos] != ':') {
+        return fail();
+    }
+    pos++;
+    skipSpace(json, pos);
+
+    if (!scanValue(json, pos, field.value)) {
+        return fail();
+    }
+    return true;
+}
+
+// Closing brace at pos; only whitespace may follow it
+bool JsonReader::finish() {
+    finished = true;
+    pos++;
+    skipSpace(json, pos);
+    if (pos != json.size()) {
+        return fail();
+    }
+    return false;
+}
+
+bool JsonStructuralReader::expect(char c) {
+    skipSpace(json, pos);
+    if (cursor >= index.size() || index[cursor] != pos || json[pos] != c) {
+        return false;
+    }
+    cursor++;
+    pos++;
+    return true;
+}
+
+// Opening quote already consumed; the closing quote is the next entry
+bool JsonStructuralReader::readString(std::string_view& contents, bool& escaped) {
+    if (cursor >= index.size() || json[index[cursor]] != '"') {
+        return false;
+    }
+    std::size_t close = index[cursor++];
+    contents = json.substr(pos, close - pos);
+    const char* end = contents.data() + contents.size();
+    escaped = simd::findByte(contents.data(), end, '\\') != end;
+    pos = close + 1;
+    return true;
+}
+
+// Walks the container's index entries through the same grammar as the
+// direct reader; only the bytes of scalars are read
+bool JsonStructuralReader::readContainer(JsonValue& value) {
+    std::size_t start = pos;
+    ContainerGrammar grammar;
+    for (;;) {
+        skipSpace(json, pos);
+        if (pos >= json.size()) {
+            return false;
+        }
+        if (cursor >= index.size() || index[cursor] != pos) {
+            // Scalars hold no structurals, so the bytes up to the next entry are one
+            JsonType type;
+            if (!scanScalar(json, pos, type) || !grammar.value()) {
+                return false;
+            }
+            continue;
+        }
+
+        char c = json[pos];
+        cursor++;
+        pos++;
+        bool ok;
+        switch (c) {
+            case '"':
+                // The closing quote is the next entry
+                if (cursor >= index.size() || json[index[cursor]] != '"') {
+                    return false;
+                }
+                pos = index[cursor++] + 1;
+                ok = grammar.string();
+                break;
+            case '{':
+            case '[':
+                ok = grammar.open(c == '{');
+                break;
+            case '}':
+            case ']':
+                ok = grammar.close(c == '}');
+                if (ok && grammar.done()) {
+                    value = JsonValue(json[start] == '{' ? JsonType::Object : JsonType::Array,
+                                      json.substr(start, pos - start), false);
+                    return true;
+                }
+                break;
+            case ':':
+                ok = grammar.colon();
+                break;
+            default:
+                ok = grammar.comma();
+                break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+bool JsonStructuralReader::next(JsonField& field) {
+    if (failed || finished) {
+        return false;
+    }
+
+    if (!started) {
+        started = true;
+        if (!expect('{')) {
+            return fail();
+        }
+        if (expect('}')) {
+            return finish();
+        }
+    } else {
+        if (expect('}')) {
+            return finish();
+        }
+        if (!expect(',')) {
+            return fail();
+        }
+    }
+
+    if (!expect('"') || !readString(field.key, field.keyEscaped) || !expect(':')) {
+        return fail();
+    }
+
+    skipSpace(json, pos);
+    if (pos >= json.size()) {
+        return fail();
+    }
+    char c = json[pos];
+    if (c == '"') {
+        std::string_view contents;
+        bool escaped;
+        if (!expect('"') || !readString(contents, escaped)) {
+            return fail();
+        }
+        field.value = JsonValue(JsonType::String, contents, escaped);
+        return true;
+    }
+    if (c == '{' || c == '[') {
+        if (cursor >= index.size() || index[cursor] != pos || !readContainer(field.value)) {
+            return fail();
+        }
+        return true;
+    }
+    // Scalars hold no structurals, so the byte scanner is the right tool
+    if (!scanValue(json, pos, field.value)) {
+        return fail();
+    }
+    return true;
+}
+
+// Closing brace consumed; only whitespace may follow it
+bool JsonStructuralReader::finish() {
+    finished = true;
+    skipSpace(json, pos);
+    if (pos != json.size() || cursor != index.size()) {
+        return fail();
+    }
+    return false;
+}
+
+namespace {
+
+// Reused between documents; the server handles one request at a time
+std::vector<std::uint32_t>& sharedStructuralIndex() {
+    static std::vector<std::uint32_t> index;
+    return index;
+}
+
+} // namespace
+
+JsonObjectReader::JsonObjectReader(std::string_view json)
+    : direct(json),
+      structural(json, sharedStructuralIndex()),
+      indexed(json.size() >= kStructuralIndexThreshold && json.size() <= UINT32_MAX) {
+    if (indexed) {
+        indexValid = buildStructuralIndex(json, sharedStructuralIndex());
+    }
+}
+
+namespace {
+
+// Bytes that cannot appear raw inside a JSON string
+struct EscapeTable {
+    bool needs[256] = {};
+
+    constexpr EscapeTable() {
+        for (int c = 0; c < 0x20; c++) needs[c] = true;
+        needs[static_cast<unsigned char>('"')] = true;
+        needs[static_cast<unsigned char>('\\')] = true;
+    }
+};
+
+constexpr EscapeTable kEscapes;
+
+void appendEscaped(std::string& out, char c) {
+    switch (c) {
+        case '"': out.append("\\\"", 2); return;
+        case '\\': out.append("\\\\", 2); return;
+        case '\b': out.append("\\b", 2); return;
+        case '\f': out.append("\\f", 2); return;
+        case '\n': out.append("\\n", 2); return;
+        case '\r': out.append("\\r", 2); return;
+        case '\t': out.append("\\t", 2); return;
+        default: break;
+    }
+    static const char hex[] = "0123456789abcdef";
+    char code[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF]};
+    out.append(code, sizeof(code));
+}
+
+} // namespace
+
+void appendJsonString(std::string& out, std::string_view text) {
+    out.push_back('"');
+    // Copy clean runs whole; most strings are a single run
+    std::size_t runStart = 0;
+    for (std::size_t i = 0; i < text.size(); i++) {
+        if (kEscapes.needs[static_cast<unsigned char>(text[i])]) {
+            out.append(text.data() + runStart, i - runStart);
+            appendEscaped(out, text[i]);
+            runStart = i + 1;
+        }
+    }
+    out.append(text.data() + runStart, text.size() - runStart);
+    out.push_back('"');
+}
+
+void appendJsonNumber(std::string& out, std::int64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
+
+void appendJsonNumber(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out.append("null", 4);
+        return;
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
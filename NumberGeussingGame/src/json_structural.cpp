@@ -0,0 +1,161 @@
+#include "../include/json_structural.h"
+#include "../include/simd_scan.h"
+#include <cstring>
+
+namespace {
+
+constexpr std::uint64_t kEvenBits = 0x5555555555555555ULL;
+constexpr std::uint64_t kOddBits = ~kEvenBits;
+
+// Bitmasks for one 64-byte block; bit i describes byte i
+struct BlockMasks {
+    std::uint64_t quotes = 0;
+    std::uint64_t backslashes = 0;
+    std::uint64_t structurals = 0;
+};
+
+#if defined(SIMD_SCAN_AVX2)
+std::uint64_t movemask32(__m256i hits) {
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(hits));
+}
+
+void classifyBlock(const char* p, BlockMasks& masks) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    // Clearing 0x20 folds '{' '}' onto '[' ']'
+    const __m256i foldMask = _mm256_set1_epi8(static_cast<char>(0xDF));
+    const __m256i openBracket = _mm256_set1_epi8('[');
+    const __m256i closeBracket = _mm256_set1_epi8(']');
+
+    for (int half = 0; half < 2; half++) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + half * 32));
+        __m256i folded = _mm256_and_si256(block, foldMask);
+        __m256i structural = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, openBracket), _mm256_cmpeq_epi8(folded, closeBracket)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, colon), _mm256_cmpeq_epi8(block, comma)));
+        int shift = half * 32;
+        masks.quotes |= movemask32(_mm256_cmpeq_epi8(block, quote)) << shift;
+        masks.backslashes |= movemask32(_mm256_cmpeq_epi8(block, backslash)) << shift;
+        masks.structurals |= movemask32(structural) << shift;
+    }
+}
+#elif defined(SIMD_SCAN_SSE2)
+std::uint64_t movemask16(__m128i hits) {
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(hits));
+}
+
+void classifyBlock(const char* p, BlockMasks& masks) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    // Clearing 0x20 folds '{' '}' onto '[' ']'
+    const __m128i foldMask = _mm_set1_epi8(static_cast<char>(0xDF));
+    const __m128i openBracket = _mm_set1_epi8('[');
+    const __m128i closeBracket = _mm_set1_epi8(']');
+
+    for (int quarter = 0; quarter < 4; quarter++) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + quarter * 16));
+        __m128i folded = _mm_and_si128(block, foldMask);
+        __m128i structural = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, openBracket), _mm_cmpeq_epi8(folded, closeBracket)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, colon), _mm_cmpeq_epi8(block, comma)));
+        int shift = quarter * 16;
+        masks.quotes |= movemask16(_mm_cmpeq_epi8(block, quote)) << shift;
+        masks.backslashes |= movemask16(_mm_cmpeq_epi8(block, backslash)) << shift;
+        masks.structurals |= movemask16(structural) << shift;
+    }
+}
+#else
+void classifyBlock(const char* p, BlockMasks& masks) {
+    for (int i = 0; i < 64; i++) {
+        std::uint64_t bit = std::uint64_t(1) << i;
+        switch (p[i]) {
+            case '"': masks.quotes |= bit; break;
+            case '\\': masks.backslashes |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                masks.structurals |= bit;
+                break;
+            default: break;
+        }
+    }
+}
+#endif
+
+// Bits of characters preceded by an odd-length run of backslashes.
+// Runs are split into those starting on even and odd bit positions; adding
+// the start bits to the run carries past its end, and the parity of where
+// the carry lands tells whether the run length was odd. carry records an odd
+// run that reaches the end of the block.
+std::uint64_t findEscaped(std::uint64_t backslashes, std::uint64_t& carry) {
+    std::uint64_t starts = backslashes & ~(backslashes << 1);
+    std::uint64_t evenStartMask = kEvenBits ^ carry;
+    std::uint64_t evenStarts = starts & evenStartMask;
+    std::uint64_t oddStarts = starts & ~evenStartMask;
+
+    std::uint64_t evenCarries = backslashes + evenStarts;
+    std::uint64_t oddCarries = backslashes + oddStarts;
+    bool endsOdd = oddCarries < backslashes;
+    oddCarries |= carry;
+    carry = endsOdd ? 1 : 0;
+
+    std::uint64_t evenCarryEnds = evenCarries & ~backslashes;
+    std::uint64_t oddCarryEnds = oddCarries & ~backslashes;
+    return (evenCarryEnds & kOddBits) | (oddCarryEnds & kEvenBits);
+}
+
+// Bit i set when an odd number of bits at or below i are set
+std::uint64_t prefixXor(std::uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+void appendPositions(std::vector<std::uint32_t>& index, std::uint32_t base, std::uint64_t bits) {
+    while (bits) {
+        index.push_back(base + simd::countTrailingZeros64(bits));
+        bits &= bits - 1;
+    }
+}
+
+} // namespace
+
+bool buildStructuralIndex(std::string_view json, std::vector<std::uint32_t>& index) {
+    index.clear();
+    // Rough guess: one structural every eight bytes
+    index.reserve(json.size() / 8 + 16);
+
+    std::uint64_t escapeCarry = 0;
+    std::uint64_t inString = 0;     // All ones while inside a string
+    const char* data = json.data();
+    std::size_t size = json.size();
+
+    for (std::size_t offset = 0; offset < size; offset += 64) {
+        BlockMasks masks;
+        if (size - offset >= 64) {
+            classifyBlock(data + offset, masks);
+        } else {
+            // Pad the tail with spaces, which match nothing
+            char tail[64];
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, data + offset, size - offset);
+            classifyBlock(tail, masks);
+        }
+
+        std::uint64_t escaped = findEscaped(masks.backslashes, escapeCarry);
+        std::uint64_t quotes = masks.quotes & ~escaped;
+        // Covers each opening quote and the string body, not the closing quote
+        std::uint64_t stringMask = prefixXor(quotes) ^ inString;
+        inString = (stringMask >> 63) ? ~std::uint64_t(0) : 0;
+
+        appendPositions(index, static_cast<std::uint32_t>(offset), (masks.structurals & ~stringMask) | quotes);
+    }
+
+    return inString == 0;
+}
@@ -1,5 +1,4 @@
 #include <iostream>
-#include <random>
 #include <string>
 #include <sstream>
 #include <fstream>
@@ -8,59 +7,42 @@
 #include <thread>
 #include <filesystem>
 #include <cstring>
+#include <algorithm>
+#include <chrono>
 
-#ifdef _WIN32
-    #include <winsock2.h>
-    #include <ws2tcpip.h>
-    #pragma comment(lib, "ws2_32.lib")
-    typedef SOCKET socket_t;
-    #define CLOSE_SOCKET closesocket
-    #define SOCKET_ERROR_CODE WSAGetLastError()
-#else
-    #include <unistd.h>
-    #include <sys/socket.h>
-    #include <netinet/in.h>
-    #include <arpa/inet.h>
-    typedef int socket_t;
-    #define CLOSE_SOCKET close
-    #define SOCKET_ERROR_CODE errno
-    #define INVALID_SOCKET -1
-#endif
-
+#include "../include/socket_compat.h"
 #include "../include/database.h"
 #include "../include/crypto_util.h"
+#include "../include/hot_upgrade.h"
+#include "../include/socket_profile.h"
+#include "../include/http_request.h"
+#include "../include/http_response.h"
+#include "../include/router.h"
+#include "../include/json.h"
+#include "../include/json_bind.h"
+#include "../include/wire_format.h"
+#include "../include/game_sessions.h"
+#include "../include/fast_random.h"
+#include "../include/game_rules.h"
+#include "../include/optimal_play.h"
+#include "../include/game_rooms.h"
+#include <array>
 
 namespace fs = std::filesystem;
 
+// Games in progress; the target never leaves the server until the game ends
+GameSessionStore gameSessions(GameSessionStore::idleTimeoutFromEnvironment());
+
+// Expected attempts of perfect play, reported next to each win
+OptimalPlayCache optimalPlay;
+
+// Multiplayer rooms and their event streams
+RoomRegistry gameRooms;
+constexpr std::time_t kRoomHeartbeatSeconds = 15;
+
 // Function to generate a random number between min and max (inclusive)
-int generateRandomNumber(int min, int max) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(min, max);
-    return distrib(gen);
-}
-
-// Function to generate a clue based on how close the guess is to the target
-std::string generateClue(int guess, int target, int min, int max) {
-    int diff = std::abs(guess - target);
-    int range = max - min;
-    double percentDiff = static_cast<double>(diff) / range;
-    
-    std::string direction = (guess < target) ? "higher" : "lower";
-    
-    if (diff == 0) {
-        return "Correct!";
-    } else if (percentDiff <= 0.05) {
-        return "Very hot! The number is " + direction + ".";
-    } else if (percentDiff <= 0.1) {
-        return "Hot! The number is " + direction + ".";
-    } else if (percentDiff <= 0.2) {
-        return "Warm. The number is " + direction + ".";
-    } else if (percentDiff <= 0.4) {
-        return "Cool. The number is " + direction + ".";
-    } else {
-        return "Cold! The number is " + direction + ".";
-    }
+std::int64_t generateRandomNumber(std::int64_t min, std::int64_t max) {
+    return randomInRange(min, max);
 }
 
 // Function to read a file into a string
@@ -76,733 +58,1003 @@ std::string readFile(const std::string& filename) {
     return buffer.str();
 }
 
-// Structure to hold HTTP request data
-struct HttpRequest {
-    std::string method;
-    std::string path;
-    std::string body;
-    std::unordered_map<std::string, std::string> headers;
-    std::unordered_map<std::string, std::string> query_params;
+// Append one leaderboard row as an object in the negotiated format
+void appendLeaderboardEntry(std::string& out, WireFormat format, const Database::LeaderboardEntry& entry) {
+    std::string_view username = entry.username;
+    if (username.empty()) {
+        username = "Unknown";
+    }
+    
+    ObjectBuilder builder(out, format);
+    builder.add("username", username)
+           .add("best_score", entry.best_score)
+           .add("games_played", entry.games_played)
+           .add("wins", entry.wins)
+           .build();
+}
+
+// API request bodies, bound from JSON, MessagePack or CBOR by bindBody()
+struct CredentialsRequest {
+    std::string username;
+    std::string password;
+};
+
+// Bound of a custom range; present tells an explicit 0 from no value
+struct RangeBound {
+    std::int64_t value = 0;
+    bool present = false;
+};
+
+bool bindValue(const JsonValue& value, RangeBound& out) {
+    out.present = value.asInt64(out.value);
+    return out.present;
+}
+
+struct NewGameRequest {
+    int user_id = 0;
+    JsonValue difficulty;
+    RangeBound min;         // Only read for difficulty "custom"
+    RangeBound max;
+};
+
+// Opaque game or room ID, sent as a hex string
+struct HexId {
+    std::uint64_t value = 0;
+};
+
+bool bindValue(const JsonValue& value, HexId& out) {
+    return value.type() == JsonType::String && parseGameId(value.raw(), out.value);
+}
+
+// Attempts, range and player come from the session, not the client
+struct GuessRequest {
+    HexId gameId;
+    std::int64_t guess = 0;
+};
+
+struct GiveUpRequest {
+    HexId gameId;
+};
+
+// Rooms are created with a NewGameRequest; the target stays in the room.
+// The player is the member the token was issued to, not a field of the body.
+struct RoomGuessRequest {
+    HexId roomId;
+    HexId memberToken;
+    std::int64_t guess = 0;
+};
+
+template <> struct JsonBinding<CredentialsRequest> {
+    static constexpr auto fields = std::make_tuple(
+        jsonField("username", &CredentialsRequest::username),
+        jsonField("password", &CredentialsRequest::password));
+};
+
+template <> struct JsonBinding<NewGameRequest> {
+    static constexpr auto fields = std::make_tuple(
+        jsonField("user_id", &NewGameRequest::user_id),
+        jsonOptional("difficulty", &NewGameRequest::difficulty),
+        jsonOptional("min", &NewGameRequest::min),
+        jsonOptional("max", &NewGameRequest::max));
 };
 
-// Parse HTTP request
-HttpRequest parseHttpRequest(const std::string& requestStr) {
-    HttpRequest request;
-    std::istringstream stream(requestStr);
-    std::string line;
+template <> struct JsonBinding<GuessRequest> {
+    static constexpr auto fields = std::make_tuple(
+        jsonField("gameId", &GuessRequest::gameId),
+        jsonField("guess", &GuessRequest::guess));
+};
+
+template <> struct JsonBinding<GiveUpRequest> {
+    static constexpr auto fields = std::make_tuple(
+        jsonField("gameId", &GiveUpRequest::gameId));
+};
+
+template <> struct JsonBinding<RoomGuessRequest> {
+    static constexpr auto fields = std::make_tuple(
+        jsonField("roomId", &RoomGuessRequest::roomId),
+        jsonField("memberToken", &RoomGuessRequest::memberToken),
+        jsonField("guess", &RoomGuessRequest::guess));
+};
+
+// Reply to a body that failed to bind, naming the offending field
+void sendBindError(HttpResponse& response, const JsonBindResult& result) {
+    std::string message = "Invalid request";
+    switch (result.status) {
+        case JsonBindStatus::Malformed:
+            message += ": malformed body";
+            break;
+        case JsonBindStatus::Missing:
+            message += ": missing ";
+            message += result.field;
+            break;
+        case JsonBindStatus::WrongType:
+            message += ": wrong type for ";
+            message += result.field;
+            break;
+        case JsonBindStatus::Ok:
+            break;
+    }
+    std::cout << message << std::endl;
     
-    // Parse request line
-    if (std::getline(stream, line)) {
-        std::istringstream requestLine(line);
-        requestLine >> request.method;
-        
-        std::string pathWithQuery;
-        requestLine >> pathWithQuery;
+    ObjectBuilder builder(response.beginBody(), response.format());
+    builder.add("success", false)
+           .add("message", message)
+           .build();
+    response.endBody();
+}
+
+// Record ended games as losses, all in one transaction
+bool saveAsLosses(Database& db, const std::vector<GameSession>& sessions) {
+    static std::vector<Database::FinishedGame> finished;
+    finished.clear();
+    for (const GameSession& session : sessions) {
+        finished.push_back({session.userId, session.target, session.attempts, false, session.min, session.max});
+    }
+    return db.saveGames(finished);
+}
+
+// Record games idle past the timeout as losses
+void expireAbandonedGames(Database& db) {
+    static std::vector<GameSession> expired;
+    expired.clear();
+    if (gameSessions.expire(expired) == 0) {
+        return;
+    }
+    
+    bool saved = saveAsLosses(db, expired);
+    std::cout << "Expired " << expired.size() << " abandoned games"
+              << (saved ? "" : " (failed to save)") << ", active games: " << gameSessions.size() << std::endl;
+}
+
+// Games live only in this process's memory; pass the ones in progress to
+// the binary taking over. If that fails they are lost, not counted as losses.
+void handOverLiveGames() {
+    std::string state;
+    gameSessions.snapshot(state);
+    std::size_t live = gameSessions.size();
+    if (HotUpgrade::sendState(state)) {
+        std::cout << "Handed " << live << " games in progress to the new binary" << std::endl;
+    } else {
+        std::cerr << "Could not hand over " << live << " games in progress" << std::endl;
+    }
+}
+
+// Take over the games of the process this one replaced, before serving
+void takeOverLiveGames() {
+    std::string state;
+    if (!HotUpgrade::confirmReady(state)) {
+        return;
+    }
+    if (gameSessions.restore(state)) {
+        std::cout << "Took over " << gameSessions.size() << " games in progress" << std::endl;
+    } else {
+        std::cerr << "Games in progress from the previous binary could not be restored" << std::endl;
+    }
+}
+
+#ifndef _WIN32
+// Descriptor kept in reserve for shedConnection()
+int reserveDescriptor = -1;
+
+void openReserveDescriptor() {
+    if (reserveDescriptor < 0) {
+        reserveDescriptor = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+}
+#endif
+
+// accept() failed for lack of descriptors. The connection stays queued and
+// the listener readable, so the loop would spin on the same error. Give up
+// the reserve descriptor to accept it, answer 503 and close it; if even that
+// fails, pause before trying again.
+void shedConnection(socket_t listener) {
+#ifndef _WIN32
+    if (reserveDescriptor >= 0) {
+        close(reserveDescriptor);
+        reserveDescriptor = -1;
+        socket_t client = accept(listener, nullptr, nullptr);
+        if (client != INVALID_SOCKET) {
+            static std::string unavailable;
+            writeError(unavailable, HttpError::ServiceUnavailable);
+            send(client, unavailable.data(), unavailable.size(), MSG_NOSIGNAL);
+            CLOSE_SOCKET(client);
+        }
+        openReserveDescriptor();
+        if (client != INVALID_SOCKET) {
+            return;
+        }
+    }
+#else
+    (void)listener;
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+// Keep room event streams open and drop the ones whose client went away
+void heartbeatRooms() {
+    static std::time_t lastHeartbeat = std::time(nullptr);
+    std::time_t now = std::time(nullptr);
+    if (now - lastHeartbeat < kRoomHeartbeatSeconds) {
+        return;
+    }
+    lastHeartbeat = now;
+    gameRooms.heartbeat();
+}
+
+// "message" and "correct" of every guess reply, encoded once per format
+// so a guess response is assembled from constant bytes
+std::string_view clueFields(WireFormat format, Clue clue, bool higher) {
+    static const std::array<std::string, 3 * kClueCount * 2> fragments = [] {
+        std::array<std::string, 3 * kClueCount * 2> table;
+        const WireFormat formats[] = {WireFormat::Json, WireFormat::MessagePack, WireFormat::Cbor};
+        for (WireFormat f : formats) {
+            for (int c = 0; c < kClueCount; c++) {
+                for (int h = 0; h < 2; h++) {
+                    std::string scratch;
+                    ObjectBuilder builder(scratch, f);
+                    builder.add("message", clueMessage(static_cast<Clue>(c), h == 1))
+                           .add("correct", c == static_cast<int>(Clue::Correct));
+                    table[(static_cast<int>(f) * kClueCount + c) * 2 + h] = std::string(builder.fields());
+                }
+            }
+        }
+        return table;
+    }();
+    return fragments[(static_cast<int>(format) * kClueCount + static_cast<int>(clue)) * 2 + (higher ? 1 : 0)];
+}
+
+// Reply to a guess or give-up for a game that is not in progress
+void sendGameNotFound(HttpResponse& response) {
+    std::cout << "Game not found or already finished" << std::endl;
+    
+    ObjectBuilder builder(response.beginBody(), response.format());
+    builder.add("success", false)
+           .add("message", "Game not found or already finished")
+           .build();
+    response.endBody();
+}
+
+// Empty array in the negotiated format
+void sendEmptyArray(HttpResponse& response) {
+    ArrayBuilder empty(response.beginBody(), response.format(), 0);
+    empty.build();
+    response.endBody();
+}
+
+void handleIndex(const HttpRequest&, Database&, HttpResponse& response) {
+    std::cout << "Serving index.html..." << std::endl;
+    // Serve index.html
+    std::string html = readFile("public/index.html");
+    if (!html.empty()) {
+        std::cout << "Index file read successfully" << std::endl;
+        response.send(ContentKind::Html, html);
+    } else {
+        std::cout << "Failed to read index file" << std::endl;
+        response.notFound();
+    }
+}
+
+void handleLoginPage(const HttpRequest&, Database&, HttpResponse& response) {
+    std::cout << "Serving login.html..." << std::endl;
+    // Serve login.html
+    std::string html = readFile("public/login.html");
+    if (!html.empty()) {
+        response.send(ContentKind::Html, html);
+    } else {
+        response.notFound();
+    }
+}
+
+void handleSignupPage(const HttpRequest&, Database&, HttpResponse& response) {
+    std::cout << "Serving signup.html..." << std::endl;
+    // Serve signup.html
+    std::string html = readFile("public/signup.html");
+    if (!html.empty()) {
+        response.send(ContentKind::Html, html);
+    } else {
+        response.notFound();
+    }
+}
+
+void handleCss(const HttpRequest& req, Database&, HttpResponse& response) {
+    std::cout << "Serving CSS file: " << req.path << std::endl;
+    // Serve CSS files
+    std::string css = readFile("public" + std::string(req.path));
+    if (!css.empty()) {
+        response.send(ContentKind::Css, css);
+    } else {
+        response.notFound();
+    }
+}
+
+void handleSignup(const HttpRequest& req, Database& db, HttpResponse& response) {
+    std::cout << "Handling signup..." << std::endl;
+    // Handle signup
+    CredentialsRequest request;
+    JsonBindResult bound = bindBody(req.body, bodyFormat(req), request);
+    if (bound.ok()) {
+        const std::string& username = request.username;
+        const std::string& password = request.password;
         
-        // Split path and query parameters
-        size_t queryPos = pathWithQuery.find('?');
-        if (queryPos != std::string::npos) {
-            request.path = pathWithQuery.substr(0, queryPos);
+        // Check if username already exists
+        if (db.userExists(username)) {
+            ObjectBuilder builder(response.beginBody(), response.format());
+            builder.add("success", false)
+                   .add("message", "Username already exists");
             
-            // Parse query parameters
-            std::string queryString = pathWithQuery.substr(queryPos + 1);
-            std::istringstream queryStream(queryString);
-            std::string param;
+            builder.build();
+            response.endBody();
+        } else {
+            // Hash the password
+            std::string passwordHash = CryptoUtil::hashPassword(password);
             
-            while (std::getline(queryStream, param, '&')) {
-                size_t equalsPos = param.find('=');
-                if (equalsPos != std::string::npos) {
-                    std::string key = param.substr(0, equalsPos);
-                    std::string value = param.substr(equalsPos + 1);
-                    request.query_params[key] = value;
-                }
+            // Create user
+            if (db.createUser(username, passwordHash)) {
+                // Get user ID
+                int userId = 0;
+                db.verifyUser(username, passwordHash, userId);
+                
+                ObjectBuilder builder(response.beginBody(), response.format());
+                builder.add("success", true)
+                       .add("user_id", userId);
+                
+                builder.build();
+                response.endBody();
+            } else {
+                ObjectBuilder builder(response.beginBody(), response.format());
+                builder.add("success", false)
+                       .add("message", "Failed to create user");
+                
+                builder.build();
+                response.endBody();
+            }
+        }
+    } else {
+        sendBindError(response, bound);
+    }
+}
+
+void handleLogin(const HttpRequest& req, Database& db, HttpResponse& response) {
+    std::cout << "Handling login..." << std::endl;
+    // Handle login
+    try {
+        std::cout << "Parsing login JSON..." << std::endl;
+        CredentialsRequest request;
+        JsonBindResult bound = bindBody(req.body, bodyFormat(req), request);
+        std::cout << "Checking username/password fields..." << std::endl;
+        if (bound.ok()) {
+            const std::string& username = request.username;
+            const std::string& password = request.password;
+            
+            std::cout << "Login attempt for user: " << username << std::endl;
+            
+            // Hash the password
+            std::cout << "Hashing password..." << std::endl;
+            std::string passwordHash = CryptoUtil::hashPassword(password);
+            
+            // Verify user
+            std::cout << "Verifying user credentials..." << std::endl;
+            int userId = 0;
+            bool loginSuccess = false;
+            
+            try {
+                loginSuccess = db.verifyUser(username, passwordHash, userId);
+                std::cout << "Verification result: " << (loginSuccess ? "success" : "failed") 
+                          << ", userId: " << userId << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << "Exception in verifyUser: " << e.what() << std::endl;
+                loginSuccess = false;
+            }
+            
+            if (loginSuccess && userId > 0) {
+                std::cout << "Login successful, building response..." << std::endl;
+                ObjectBuilder builder(response.beginBody(), response.format());
+                builder.add("success", true)
+                       .add("user_id", userId);
+                
+                builder.build();
+                response.endBody();
+            } else {
+                std::cout << "Login failed, invalid credentials" << std::endl;
+                ObjectBuilder builder(response.beginBody(), response.format());
+                builder.add("success", false)
+                       .add("message", "Invalid username or password");
+                
+                builder.build();
+                response.endBody();
             }
         } else {
-            request.path = pathWithQuery;
+            std::cout << "Login failed, invalid request format" << std::endl;
+            sendBindError(response, bound);
         }
+    } catch (const std::exception& e) {
+        std::cerr << "Error in login handling: " << e.what() << std::endl;
+        
+        ObjectBuilder builder(response.beginBody(), response.format());
+        builder.add("success", false)
+               .add("message", "An error occurred during login");
+        
+        builder.build();
+        response.endBody();
     }
+}
+
+// Range of a new game or room; replies and returns false for a bad custom range
+bool resolveRange(const NewGameRequest& request, HttpResponse& response, DifficultyRange& range) {
+    // Unknown or missing difficulties play medium
+    range = kMediumRange;
     
-    // Parse headers
-    while (std::getline(stream, line) && line != "\r") {
-        if (line.back() == '\r') {
-            line.pop_back();  // Remove \r
+    if (request.difficulty.equals("custom")) {
+        if (!request.min.present || !request.max.present || request.min.value >= request.max.value) {
+            std::cout << "Rejected custom range" << std::endl;
+            
+            ObjectBuilder builder(response.beginBody(), response.format());
+            builder.add("success", false)
+                   .add("message", "Custom difficulty needs integer min and max with min below max")
+                   .build();
+            response.endBody();
+            return false;
+        }
+        range = {request.min.value, request.max.value};
+    } else {
+        for (const DifficultyProfile& profile : kDifficultyProfiles) {
+            if (request.difficulty.equals(profile.name)) {
+                range = profile.range;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void handleNewGame(const HttpRequest& req, Database&, HttpResponse& response) {
+    // Start new game
+    NewGameRequest request;
+    JsonBindResult bound = bindBody(req.body, bodyFormat(req), request);
+    if (bound.ok()) {
+        DifficultyRange range;
+        if (!resolveRange(request, response, range)) {
+            return;
         }
+        std::int64_t min = range.min;
+        std::int64_t max = range.max;
+        
+        std::int64_t targetNumber = generateRandomNumber(min, max);
+        std::uint64_t gameId = gameSessions.create(request.user_id, targetNumber, min, max);
+        char gameIdText[kGameIdLength];
+        std::cout << "New game started! Target number to guess: " << targetNumber
+                  << ", active games: " << gameSessions.size()
+                  << " (" << gameSessions.reservedBytes() / 1024 << " KB of records)" << std::endl;
+        
+        ObjectBuilder builder(response.beginBody(), response.format());
+        builder.add("success", true)
+               .add("min", min)
+               .add("max", max)
+               .add("gameId", formatGameId(gameId, gameIdText));
         
-        size_t pos = line.find(':');
-        if (pos != std::string::npos) {
-            std::string key = line.substr(0, pos);
-            std::string value = line.substr(pos + 1);
+        builder.build();
+        response.endBody();
+    } else {
+        sendBindError(response, bound);
+    }
+}
+
+void handleGuess(const HttpRequest& req, Database& db, HttpResponse& response) {
+    // Handle guess
+    try {
+        std::cout << "Received guess request with body: " << req.body << std::endl;
+        GuessRequest request;
+        JsonBindResult bound = bindBody(req.body, bodyFormat(req), request);
+        GameSession session;
+        if (bound.ok() && !gameSessions.guess(request.gameId.value, request.guess, session)) {
+            sendGameNotFound(response);
+        } else if (bound.ok()) {
+            std::int64_t guess = request.guess;
+            int attempts = session.attempts;
+            int userId = session.userId;
+            std::int64_t min = session.min;
+            std::int64_t max = session.max;
+            std::int64_t targetNumber = session.target;
+            
+            std::cout << "Guess request - guess: " << guess 
+                      << ", attempts: " << attempts << ", userId: " << userId << std::endl;
+            
+            ObjectBuilder builder(response.beginBody(), response.format());
+            builder.add("success", true)
+                   .add("attempts", attempts);
             
-            // Trim leading spaces from value
-            while (!value.empty() && value.front() == ' ') {
-                value.erase(0, 1);
+            Clue clue = classifyGuess(guess, targetNumber, min, max);
+            if (clue == Clue::Correct) {
+                // Correct guess
+                std::cout << "CORRECT GUESS! User: " << userId << ", Attempts: " << attempts << std::endl;
+                bool saveSuccess = db.saveGame(userId, targetNumber, attempts, true, min, max);
+                
+                if (!saveSuccess) {
+                    std::cerr << "Failed to save game for user ID: " << userId << std::endl;
+                    // Even if save fails, we still want to tell the user they were correct
+                } else {
+                    std::cout << "Successfully saved win to database!" << std::endl;
+                }
+                
+                // Perfect play's average against this game; above 1 beat it
+                double optimalAttempts;
+                if (optimalPlay.lookup(distanceBetween(min, max), optimalAttempts)) {
+                    builder.add("optimalAttempts", optimalAttempts)
+                           .add("efficiency", optimalAttempts / attempts);
+                }
+                
+                std::cout << "Sending correct=true in response" << std::endl;
             }
+            builder.addEncoded(clueFields(response.format(), clue, guess < targetNumber), 2);
             
-            request.headers[key] = value;
+            builder.build();
+            response.endBody();
+        } else {
+            sendBindError(response, bound);
         }
-    }
-    
-    // Parse body if Content-Length header exists
-    if (request.headers.count("Content-Length") > 0) {
-        int contentLength = std::stoi(request.headers["Content-Length"]);
+    } catch (const std::exception& e) {
+        std::cerr << "Error in guess handling: " << e.what() << std::endl;
+        
+        ObjectBuilder errorBuilder(response.beginBody(), response.format());
+        errorBuilder.add("success", false)
+                   .add("message", "An internal error occurred: " + std::string(e.what()));
         
-        // Read body
-        char* bodyBuffer = new char[contentLength + 1];
-        stream.read(bodyBuffer, contentLength);
-        bodyBuffer[contentLength] = '\0';
-        request.body = bodyBuffer;
-        delete[] bodyBuffer;
+        errorBuilder.build();
+        response.endBody();
     }
-    
-    return request;
 }
 
-// Simple JSON parser
-class Json {
-public:
-    Json() = default;
-    
-    Json(const std::string& json) {
-        parse(json);
-    }
-    
-    bool parse(const std::string& json) {
-        size_t pos = 0;
+void handleGiveUp(const HttpRequest& req, Database& db, HttpResponse& response) {
+    // Handle give up
+    GiveUpRequest request;
+    JsonBindResult bound = bindBody(req.body, bodyFormat(req), request);
+    GameSession session;
+    if (bound.ok() && !gameSessions.end(request.gameId.value, session)) {
+        sendGameNotFound(response);
+    } else if (bound.ok()) {
+        int attempts = session.attempts;
+        int userId = session.userId;
+        std::int64_t targetNumber = session.target;
         
-        // Skip whitespace
-        while (pos < json.size() && std::isspace(json[pos])) {
-            pos++;
-        }
+        // Save the game as lost
+        bool saveSuccess = db.saveGame(userId, targetNumber, attempts, false, session.min, session.max);
         
-        if (pos < json.size() && json[pos] == '{') {
-            pos++;  // Skip {
-            parseObject(json, pos);
-            return true;
+        ObjectBuilder builder(response.beginBody(), response.format());
+        if (saveSuccess) {
+            builder.add("success", true)
+                   .add("targetNumber", targetNumber)
+                   .add("attempts", attempts);
+        } else {
+            std::cerr << "Failed to save game after give up for user ID: " << userId << std::endl;
+            builder.add("success", true) // Still return success to the client
+                   .add("targetNumber", targetNumber)
+                   .add("attempts", attempts)
+                   .add("saveError", true); // Add a flag to indicate save error
         }
         
-        return false;
+        builder.build();
+        response.endBody();
+    } else {
+        sendBindError(response, bound);
     }
+}
+
+// Room events are JSON in SSE data lines, built once per event
+std::string& roomEventBuffer() {
+    static std::string buffer;
+    buffer.clear();
+    return buffer;
+}
+
+// Band of a guess for the other players; the direction stays private
+const char* clueName(Clue clue) {
+    static const char* const names[kClueCount] = {"correct", "very hot", "hot", "warm", "cool", "cold"};
+    return names[static_cast<int>(clue)];
+}
+
+void sendRoomError(HttpResponse& response, const char* message) {
+    std::cout << message << std::endl;
     
-    bool has(const std::string& key) const {
-        return data.count(key) > 0;
+    ObjectBuilder builder(response.beginBody(), response.format());
+    builder.add("success", false)
+           .add("message", message)
+           .build();
+    response.endBody();
+}
+
+void sendRoomNotFound(HttpResponse& response) {
+    sendRoomError(response, "Room not found");
+}
+
+void handleCreateRoom(const HttpRequest& req, Database&, HttpResponse& response) {
+    NewGameRequest request;
+    JsonBindResult bound = bindBody(req.body, bodyFormat(req), request);
+    if (!bound.ok()) {
+        sendBindError(response, bound);
+        return;
+    }
+    DifficultyRange range;
+    if (!resolveRange(request, response, range)) {
+        return;
     }
     
-    std::string s(const std::string& key) const {
-        auto it = data.find(key);
-        if (it != data.end() && it->second.type == ValueType::String) {
-            return it->second.stringValue;
-        }
-        return "";
+    std::shared_ptr<GameRoom> room = gameRooms.create(range);
+    if (!room) {
+        sendRoomError(response, "Too many rooms");
+        return;
     }
+    char roomIdText[kGameIdLength];
+    std::cout << "Room created by user " << request.user_id << ", rooms: " << gameRooms.size() << std::endl;
     
-    int i(const std::string& key) const {
-        auto it = data.find(key);
-        if (it != data.end()) {
-            if (it->second.type == ValueType::Number) {
-                return static_cast<int>(it->second.numberValue);
-            } else if (it->second.type == ValueType::String) {
-                // Try to convert string to integer
-                try {
-                    return std::stoi(it->second.stringValue);
-                } catch (...) {
-                    std::cerr << "Failed to convert string value to int for key: " << key << std::endl;
-                }
-            }
-        }
-        return 0;
+    ObjectBuilder builder(response.beginBody(), response.format());
+    builder.add("success", true)
+           .add("roomId", formatGameId(room->id(), roomIdText))
+           .add("min", range.min)
+           .add("max", range.max)
+           .build();
+    response.endBody();
+}
+
+// GET /api/rooms/events?room=ID&user_id=N opens the room's event stream.
+// The first event, "welcome", goes to this member only and carries the
+// token its guesses must present.
+void handleRoomEvents(const HttpRequest& req, Database&, HttpResponse& response) {
+    std::string_view roomParam;
+    std::uint64_t roomId = 0;
+    int userId = 0;
+    QueryResult roomLookup = req.queryParam("room", roomParam);
+    QueryResult userLookup = req.queryInt("user_id", userId);
+    if (roomLookup == QueryResult::TooLong || userLookup == QueryResult::TooLong) {
+        std::cout << "Room events query too long" << std::endl;
+        response.error(HttpError::BadRequest);
+        return;
+    }
+    std::shared_ptr<GameRoom> room;
+    if (roomLookup == QueryResult::Found && parseGameId(roomParam, roomId) && userLookup == QueryResult::Found) {
+        room = gameRooms.find(roomId);
+    }
+    if (!room) {
+        sendRoomNotFound(response);
+        return;
+    }
+    if (room->memberCount() >= GameRoom::kMaxMembers) {
+        sendRoomError(response, "Room is full");
+        return;
+    }
+    if (!gameRooms.acceptsStream()) {
+        std::cout << "Event stream limit of " << gameRooms.maxStreams() << " reached" << std::endl;
+        response.error(HttpError::ServiceUnavailable);
+        return;
+    }
+    if (!response.startEventStream()) {
+        return;
     }
     
-    bool b(const std::string& key) const {
-        auto it = data.find(key);
-        if (it != data.end() && it->second.type == ValueType::Boolean) {
-            return it->second.boolValue;
-        }
-        return false;
+    std::uint64_t token = room->join(response.connection(), userId);
+    if (token == 0) {
+        return;
+    }
+    std::cout << "User " << userId << " joined room, members: " << room->memberCount() << std::endl;
+    
+    std::string& welcome = roomEventBuffer();
+    char tokenText[kGameIdLength];
+    ObjectBuilder welcomeEvent(welcome, WireFormat::Json);
+    welcomeEvent.add("memberToken", formatGameId(token, tokenText))
+                .add("user_id", userId)
+                .build();
+    if (!room->sendTo(token, "welcome", welcome)) {
+        return;
+    }
+    
+    // Also tells the new member the current round
+    std::string& event = roomEventBuffer();
+    DifficultyRange range = room->range();
+    ObjectBuilder builder(event, WireFormat::Json);
+    builder.add("user_id", userId)
+           .add("members", static_cast<std::int64_t>(room->memberCount()))
+           .add("round", static_cast<std::int64_t>(room->round()))
+           .add("min", range.min)
+           .add("max", range.max)
+           .build();
+    room->publish("joined", event);
+}
+
+// Room games are not saved to the stats: a room has many players guessing
+// at one target, so a win there says little about the winner's play
+void handleRoomGuess(const HttpRequest& req, Database&, HttpResponse& response) {
+    RoomGuessRequest request;
+    JsonBindResult bound = bindBody(req.body, bodyFormat(req), request);
+    if (!bound.ok()) {
+        sendBindError(response, bound);
+        return;
+    }
+    std::shared_ptr<GameRoom> room = gameRooms.find(request.roomId.value);
+    if (!room) {
+        sendRoomNotFound(response);
+        return;
     }
     
-private:
-    enum class ValueType {
-        String,
-        Number,
-        Boolean,
-        Null
-    };
+    GameRoom::GuessOutcome outcome;
+    if (!room->guess(request.memberToken.value, request.guess, outcome)) {
+        sendRoomError(response, "Not a member of this room");
+        return;
+    }
+    bool correct = outcome.clue == Clue::Correct;
+    std::cout << "Room guess - user: " << outcome.userId << ", guess: " << request.guess
+              << ", round: " << outcome.round << ", attempts: " << outcome.attempts << std::endl;
     
-    struct Value {
-        ValueType type;
-        std::string stringValue;
-        double numberValue = 0.0;
-        bool boolValue = false;
-    };
+    ObjectBuilder builder(response.beginBody(), response.format());
+    builder.add("success", true)
+           .add("round", static_cast<std::int64_t>(outcome.round))
+           .add("attempts", static_cast<std::int64_t>(outcome.attempts))
+           .addEncoded(clueFields(response.format(), outcome.clue, outcome.higher), 2)
+           .build();
+    response.endBody();
     
-    std::unordered_map<std::string, Value> data;
+    std::string& event = roomEventBuffer();
+    ObjectBuilder guessEvent(event, WireFormat::Json);
+    guessEvent.add("user_id", outcome.userId)
+              .add("round", static_cast<std::int64_t>(outcome.round))
+              .add("attempts", static_cast<std::int64_t>(outcome.attempts))
+              .add("clue", clueName(outcome.clue))
+              .build();
+    room->publish("guess", event);
     
-    void parseObject(const std::string& json, size_t& pos) {
-        while (pos < json.size()) {
-            // Skip whitespace
-            while (pos < json.size() && std::isspace(json[pos])) {
-                pos++;
-            }
-            
-            if (pos < json.size() && json[pos] == '}') {
-                pos++;  // Skip }
-                break;
-            }
-            
-            if (pos < json.size() && json[pos] == ',') {
-                pos++;  // Skip ,
-                continue;
+    if (correct) {
+        std::string& won = roomEventBuffer();
+        ObjectBuilder wonEvent(won, WireFormat::Json);
+        wonEvent.add("user_id", outcome.userId)
+                .add("round", static_cast<std::int64_t>(outcome.round))
+                .add("attempts", static_cast<std::int64_t>(outcome.attempts))
+                .add("target", outcome.target)
+                .build();
+        room->publish("won", won);
+        
+        DifficultyRange range = room->range();
+        std::string& next = roomEventBuffer();
+        ObjectBuilder roundEvent(next, WireFormat::Json);
+        roundEvent.add("round", static_cast<std::int64_t>(outcome.round + 1))
+                  .add("min", range.min)
+                  .add("max", range.max)
+                  .build();
+        room->publish("round", next);
+    }
+}
+
+void handleStats(const HttpRequest& req, Database& db, HttpResponse& response) {
+    // Get stats
+    try {
+        std::string_view userIdParam;
+        QueryResult userLookup = req.queryParam("user_id", userIdParam);
+        if (userLookup == QueryResult::TooLong) {
+            std::cerr << "Stats query too long" << std::endl;
+            response.error(HttpError::BadRequest);
+        } else if (userLookup == QueryResult::Found) {
+            // Get user-specific stats; a malformed id matches no user
+            int userId = 0;
+            if (!parseInteger(userIdParam, userId)) {
+                std::cerr << "Invalid user_id in stats request: " << userIdParam << std::endl;
             }
+            Database::GameStats stats = db.getUserStats(userId);
             
-            // Parse key
-            std::string key;
-            if (pos < json.size() && json[pos] == '"') {
-                pos++;  // Skip "
-                while (pos < json.size() && json[pos] != '"') {
-                    key += json[pos++];
-                }
-                if (pos < json.size()) pos++;  // Skip "
-            }
+            ObjectBuilder builder(response.beginBody(), response.format());
+            builder.add("totalGames", stats.total_games)
+                   .add("wins", stats.wins)
+                   .add("bestScore", stats.best_score)
+                   .add("avgAttempts", stats.avg_attempts);
             
-            // Skip whitespace and :
-            while (pos < json.size() && (std::isspace(json[pos]) || json[pos] == ':')) {
-                pos++;
-            }
+            builder.build();
+            response.endBody();
+        } else {
+            // Get global stats
+            Database::GameStats stats = db.getStats();
             
-            // Parse value
-            Value value;
-            if (pos < json.size()) {
-                if (json[pos] == '"') {
-                    value.type = ValueType::String;
-                    pos++;  // Skip "
-                    while (pos < json.size() && json[pos] != '"') {
-                        value.stringValue += json[pos++];
-                    }
-                    if (pos < json.size()) pos++;  // Skip "
-                } else if (std::isdigit(json[pos]) || json[pos] == '-') {
-                    value.type = ValueType::Number;
-                    std::string numStr;
-                    while (pos < json.size() && (std::isdigit(json[pos]) || json[pos] == '.' || json[pos] == '-')) {
-                        numStr += json[pos++];
-                    }
-                    value.numberValue = std::stod(numStr);
-                } else if (json.substr(pos, 4) == "true") {
-                    value.type = ValueType::Boolean;
-                    value.boolValue = true;
-                    pos += 4;
-                } else if (json.substr(pos, 5) == "false") {
-                    value.type = ValueType::Boolean;
-                    value.boolValue = false;
-                    pos += 5;
-                } else if (json.substr(pos, 4) == "null") {
-                    value.type = ValueType::Null;
-                    pos += 4;
-                }
-            }
+            ObjectBuilder builder(response.beginBody(), response.format());
+            builder.add("totalGames", stats.total_games)
+                   .add("wins", stats.wins)
+                   .add("bestScore", stats.best_score)
+                   .add("avgAttempts", stats.avg_attempts);
             
-            data[key] = value;
+            builder.build();
+            response.endBody();
         }
+    } catch (const std::exception& e) {
+        std::cerr << "Error fetching stats: " << e.what() << std::endl;
+        
+        // Return empty stats on error
+        ObjectBuilder builder(response.beginBody(), response.format());
+        builder.add("totalGames", 0)
+               .add("wins", 0)
+               .add("bestScore", 0)
+               .add("avgAttempts", 0.0);
+        
+        builder.build();
+        response.endBody();
     }
-};
+}
 
-// Simple JSON builder
-class JsonBuilder {
-public:
-    JsonBuilder() {
-        data = "{";
+void handleLeaderboard(const HttpRequest& req, Database& db, HttpResponse& response) {
+    std::cout << "Handling leaderboard request..." << std::endl;
+    // Get leaderboard, optionally more than the default top 10
+    int limit = 10;
+    QueryResult limitLookup = req.queryInt("limit", limit);
+    if (limitLookup == QueryResult::TooLong) {
+        std::cerr << "Leaderboard query too long" << std::endl;
+        response.error(HttpError::BadRequest);
+        return;
     }
-    
-    JsonBuilder& add(const std::string& key, const std::string& value) {
-        if (data.length() > 1) {
-            data += ",";
-        }
-        data += "\"" + key + "\":\"" + value + "\"";
-        return *this;
+    if (limitLookup == QueryResult::Found) {
+        limit = std::max(1, std::min(limit, 100000));
     }
     
-    JsonBuilder& add(const std::string& key, int value) {
-        if (data.length() > 1) {
-            data += ",";
-        }
-        data += "\"" + key + "\":" + std::to_string(value);
-        return *this;
-    }
-    
-    JsonBuilder& add(const std::string& key, double value) {
-        if (data.length() > 1) {
-            data += ",";
-        }
-        data += "\"" + key + "\":" + std::to_string(value);
-        return *this;
-    }
-    
-    JsonBuilder& add(const std::string& key, bool value) {
-        if (data.length() > 1) {
-            data += ",";
+    try {
+        // One row per user; MessagePack needs the count before the rows
+        WireFormat format = response.format();
+        std::uint32_t rows = 0;
+        if (format == WireFormat::MessagePack) {
+            rows = static_cast<std::uint32_t>(std::min(limit, db.countUsers()));
         }
-        data += "\"" + key + "\":" + (value ? "true" : "false");
-        return *this;
-    }
-    
-    JsonBuilder& addArray(const std::string& key, const std::string& jsonArray) {
-        if (data.length() > 1) {
-            data += ",";
+        
+        // Stream rows into chunks as SQLite produces them
+        response.beginChunked(response.formatKind());
+        std::string& out = response.chunkBuffer();
+        ArrayBuilder array(out, format, rows);
+        bool ok = db.forEachLeaderboardEntry(limit, [&](const Database::LeaderboardEntry& entry) {
+            array.item();
+            appendLeaderboardEntry(out, format, entry);
+            response.flushIfFull();
+        });
+        array.build();
+        response.endChunked();
+        
+        if (!ok && !response.started()) {
+            // Return empty array on error
+            sendEmptyArray(response);
         }
-        data += "\"" + key + "\":" + jsonArray;
-        return *this;
-    }
-    
-    std::string build() {
-        data += "}";
-        return data;
+    } catch (const std::exception& e) {
+        std::cerr << "Error fetching leaderboard: " << e.what() << std::endl;
+        
+        // Return empty array on error
+        sendEmptyArray(response);
+        std::cout << "Returned empty leaderboard due to error" << std::endl;
     }
-    
-private:
-    std::string data;
+}
+
+// Route table, resolved to a perfect hash at compile time
+typedef void (*RouteHandler)(const HttpRequest&, Database&, HttpResponse& response);
+
+constexpr Route<RouteHandler> kRouteList[] = {
+    {"", "/", RouteMatch::Exact, handleIndex},
+    {"", "/index.html", RouteMatch::Exact, handleIndex},
+    {"", "/login.html", RouteMatch::Exact, handleLoginPage},
+    {"", "/signup.html", RouteMatch::Exact, handleSignupPage},
+    {"", "/css/", RouteMatch::Prefix, handleCss},
+    {"POST", "/api/signup", RouteMatch::Exact, handleSignup},
+    {"POST", "/api/login", RouteMatch::Exact, handleLogin},
+    {"POST", "/api/new-game", RouteMatch::Exact, handleNewGame},
+    {"POST", "/api/guess", RouteMatch::Exact, handleGuess},
+    {"POST", "/api/give-up", RouteMatch::Exact, handleGiveUp},
+    {"", "/api/stats", RouteMatch::Exact, handleStats},
+    {"", "/api/leaderboard", RouteMatch::Exact, handleLeaderboard},
+    {"POST", "/api/rooms", RouteMatch::Exact, handleCreateRoom},
+    {"", "/api/rooms/events", RouteMatch::Exact, handleRoomEvents},
+    {"POST", "/api/rooms/guess", RouteMatch::Exact, handleRoomGuess},
 };
 
-// HTTP response with JSON
-std::string createJsonResponse(const std::string& json) {
-    std::stringstream response;
-    response << "HTTP/1.1 200 OK\r\n";
-    response << "Content-Type: application/json\r\n";
-    response << "Content-Length: " << json.length() << "\r\n";
-    response << "Access-Control-Allow-Origin: *\r\n";
-    response << "\r\n";
-    response << json;
-    return response.str();
-}
-
-// HTTP response with HTML/CSS
-std::string createHtmlResponse(const std::string& content, const std::string& contentType) {
-    std::stringstream response;
-    response << "HTTP/1.1 200 OK\r\n";
-    response << "Content-Type: " << contentType << "\r\n";
-    response << "Content-Length: " << content.length() << "\r\n";
-    response << "\r\n";
-    response << content;
-    return response.str();
-}
-
-// HTTP 404 response
-std::string create404Response() {
-    std::string body = "<html><body><h1>404 Not Found</h1></body></html>";
-    std::stringstream response;
-    response << "HTTP/1.1 404 Not Found\r\n";
-    response << "Content-Type: text/html\r\n";
-    response << "Content-Length: " << body.length() << "\r\n";
-    response << "\r\n";
-    response << body;
-    return response.str();
-}
-
-// Create leaderboard JSON
-std::string createLeaderboardJson(const std::vector<Database::LeaderboardEntry>& leaderboard) {
-    try {
-        std::stringstream json;
-        json << "[";
-        for (size_t i = 0; i < leaderboard.size(); ++i) {
-            const auto& entry = leaderboard[i];
-            if (i > 0) json << ",";
-            json << "{";
-            json << "\"username\":\"" << (entry.username.empty() ? "Unknown" : entry.username) << "\",";
-            json << "\"best_score\":" << entry.best_score << ",";
-            json << "\"games_played\":" << entry.games_played << ",";
-            json << "\"wins\":" << entry.wins;
-            json << "}";
+constexpr RouteTable<RouteHandler, sizeof(kRouteList) / sizeof(kRouteList[0])> kRoutes(kRouteList);
+static_assert(kRoutes.valid(), "route table has duplicate routes");
+
+// Wait for request bytes until the deadline; false once it has passed.
+// The server reads one request at a time, so a client that sends slowly
+// must not hold up everyone else for longer than the request timeout.
+bool waitForRequestData(socket_t socket, std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+        struct pollfd readable;
+        readable.fd = socket;
+        readable.events = POLLIN;
+        readable.revents = 0;
+        int ready = POLL_SOCKETS(&readable, 1, static_cast<int>(left.count()));
+        if (ready > 0) {
+            return true;
+        }
+        if (ready < 0 && SOCKET_ERROR_CODE != EINTR) {
+            // Let recv() report the error
+            return true;
         }
-        json << "]";
-        return json.str();
-    } catch (const std::exception& e) {
-        std::cerr << "Error creating leaderboard JSON: " << e.what() << std::endl;
-        return "[]"; // Return empty array on error
-    } catch (...) {
-        std::cerr << "Unknown error creating leaderboard JSON" << std::endl;
-        return "[]"; // Return empty array on error
     }
 }
 
-void handleClient(socket_t clientSocket, Database& db) {
+void handleClient(socket_t clientSocket, Database& db, const HttpLimits& limits) {
     std::cout << "Enter handleClient" << std::endl;
-    const int bufferSize = 4096;
-    char buffer[bufferSize] = {0};
-    std::string request;
-    int bytesRead;
+    
+    // Reused across requests so steady-state responses don't allocate
+    static std::string responseBuffer;
     
     try {
-        // Read client request
+        // Read client request, parsing in place until it is complete.
+        // The buffer only grows past its inline size for requests that fit the limits.
         std::cout << "Reading client request..." << std::endl;
-        bytesRead = recv(clientSocket, buffer, bufferSize - 1, 0);
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            request = buffer;
-            
-            // Parse request
-            std::cout << "Parsing request..." << std::endl;
-            HttpRequest req = parseHttpRequest(request);
-            std::string response;
-            
-            std::cout << "Request path: " << req.path << std::endl;
-            
-            // Handle different routes
-            if (req.path == "/" || req.path == "/index.html") {
-                std::cout << "Serving index.html..." << std::endl;
-                // Serve index.html
-                std::string html = readFile("public/index.html");
-                if (!html.empty()) {
-                    std::cout << "Index file read successfully" << std::endl;
-                    response = createHtmlResponse(html, "text/html");
-                } else {
-                    std::cout << "Failed to read index file" << std::endl;
-                    response = create404Response();
-                }
-            } else if (req.path == "/login.html") {
-                std::cout << "Serving login.html..." << std::endl;
-                // Serve login.html
-                std::string html = readFile("public/login.html");
-                if (!html.empty()) {
-                    response = createHtmlResponse(html, "text/html");
-                } else {
-                    response = create404Response();
-                }
-            } else if (req.path == "/signup.html") {
-                std::cout << "Serving signup.html..." << std::endl;
-                // Serve signup.html
-                std::string html = readFile("public/signup.html");
-                if (!html.empty()) {
-                    response = createHtmlResponse(html, "text/html");
-                } else {
-                    response = create404Response();
-                }
-            } else if (req.path.find("/css/") == 0) {
-                std::cout << "Serving CSS file: " << req.path << std::endl;
-                // Serve CSS files
-                std::string css = readFile("public" + req.path);
-                if (!css.empty()) {
-                    response = createHtmlResponse(css, "text/css");
-                } else {
-                    response = create404Response();
-                }
-            } else if (req.path == "/api/signup" && req.method == "POST") {
-                std::cout << "Handling signup..." << std::endl;
-                // Handle signup
-                Json json(req.body);
-                if (json.has("username") && json.has("password")) {
-                    std::string username = json.s("username");
-                    std::string password = json.s("password");
-                    
-                    // Check if username already exists
-                    if (db.userExists(username)) {
-                        JsonBuilder builder;
-                        builder.add("success", false)
-                               .add("message", "Username already exists");
-                        
-                        response = createJsonResponse(builder.build());
-                    } else {
-                        // Hash the password
-                        std::string passwordHash = CryptoUtil::hashPassword(password);
-                        
-                        // Create user
-                        if (db.createUser(username, passwordHash)) {
-                            // Get user ID
-                            int userId = 0;
-                            db.verifyUser(username, passwordHash, userId);
-                            
-                            JsonBuilder builder;
-                            builder.add("success", true)
-                                   .add("user_id", userId);
-                            
-                            response = createJsonResponse(builder.build());
-                        } else {
-                            JsonBuilder builder;
-                            builder.add("success", false)
-                                   .add("message", "Failed to create user");
-                            
-                            response = createJsonResponse(builder.build());
-                        }
-                    }
-                } else {
-                    JsonBuilder builder;
-                    builder.add("success", false)
-                           .add("message", "Invalid request");
-                    
-                    response = createJsonResponse(builder.build());
+        RequestBuffer buffer(limits);
+        HttpRequest req;
+        ParseResult parsed = ParseResult::Incomplete;
+        bool overBudget = false;
+        bool timedOut = false;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.requestTimeoutMillis);
+        while (parsed == ParseResult::Incomplete) {
+            if (buffer.space() == 0) {
+                std::size_t wanted = std::max(req.expectedSize, buffer.capacity() * 2);
+                wanted = std::min(wanted, limits.maxRequestBytes());
+                RequestBuffer::GrowResult grown = buffer.grow(wanted);
+                if (grown == RequestBuffer::GrowResult::OverBudget) {
+                    overBudget = true;
+                    break;
                 }
-            } else if (req.path == "/api/login" && req.method == "POST") {
-                std::cout << "Handling login..." << std::endl;
-                // Handle login
-                try {
-                    std::cout << "Parsing login JSON..." << std::endl;
-                    Json json(req.body);
-                    std::cout << "Checking username/password fields..." << std::endl;
-                    if (json.has("username") && json.has("password")) {
-                        std::string username = json.s("username");
-                        std::string password = json.s("password");
-                        
-                        std::cout << "Login attempt for user: " << username << std::endl;
-                        
-                        // Hash the password
-                        std::cout << "Hashing password..." << std::endl;
-                        std::string passwordHash = CryptoUtil::hashPassword(password);
-                        
-                        // Verify user
-                        std::cout << "Verifying user credentials..." << std::endl;
-                        int userId = 0;
-                        bool loginSuccess = false;
-                        
-                        try {
-                            loginSuccess = db.verifyUser(username, passwordHash, userId);
-                            std::cout << "Verification result: " << (loginSuccess ? "success" : "failed") 
-                                      << ", userId: " << userId << std::endl;
-                        } catch (const std::exception& e) {
-                            std::cerr << "Exception in verifyUser: " << e.what() << std::endl;
-                            loginSuccess = false;
-                        }
-                        
-                        if (loginSuccess && userId > 0) {
-                            std::cout << "Login successful, building response..." << std::endl;
-                            JsonBuilder builder;
-                            builder.add("success", true)
-                                   .add("user_id", userId);
-                            
-                            response = createJsonResponse(builder.build());
-                        } else {
-                            std::cout << "Login failed, invalid credentials" << std::endl;
-                            JsonBuilder builder;
-                            builder.add("success", false)
-                                   .add("message", "Invalid username or password");
-                            
-                            response = createJsonResponse(builder.build());
-                        }
-                    } else {
-                        std::cout << "Login failed, invalid request format" << std::endl;
-                        JsonBuilder builder;
-                        builder.add("success", false)
-                               .add("message", "Invalid request");
-                        
-                        response = createJsonResponse(builder.build());
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << "Error in login handling: " << e.what() << std::endl;
-                    
-                    JsonBuilder builder;
-                    builder.add("success", false)
-                           .add("message", "An error occurred during login");
-                    
-                    response = createJsonResponse(builder.build());
+                if (grown == RequestBuffer::GrowResult::TooLarge || buffer.space() == 0) {
+                    parsed = ParseResult::BodyTooLarge;
+                    break;
                 }
-            } else if (req.path == "/api/new-game" && req.method == "POST") {
-                // Start new game
-                Json json(req.body);
-                if (json.has("user_id")) {
-                    int userId = json.i("user_id");
-                    int min = 1;
-                    int max = 100;
-                    
-                    if (json.has("difficulty")) {
-                        std::string difficulty = json.s("difficulty");
-                        if (difficulty == "easy") {
-                            min = 1;
-                            max = 50;
-                        } else if (difficulty == "hard") {
-                            min = 1;
-                            max = 200;
-                        }
-                    }
-                    
-                    int targetNumber = generateRandomNumber(min, max);
-                    std::cout << "New game started! Target number to guess: " << targetNumber << std::endl;
-                    
-                    JsonBuilder builder;
-                    builder.add("success", true)
-                           .add("min", min)
-                           .add("max", max)
-                           .add("gameId", targetNumber);
-                    
-                    response = createJsonResponse(builder.build());
-                } else {
-                    JsonBuilder builder;
-                    builder.add("success", false)
-                           .add("message", "Invalid request: missing user_id");
-                    
-                    response = createJsonResponse(builder.build());
-                }
-            } else if (req.path == "/api/guess" && req.method == "POST") {
-                // Handle guess
-                try {
-                    std::cout << "Received guess request with body: " << req.body << std::endl;
-                    Json json(req.body);
-                    if (json.has("gameId") && json.has("guess") && json.has("attempts") && json.has("user_id")) {
-                        int gameId = json.i("gameId");
-                        int guess = json.i("guess");
-                        int attempts = json.i("attempts");
-                        int userId = json.i("user_id");
-                        
-                        std::cout << "Guess request - gameId: " << gameId << ", guess: " << guess 
-                                  << ", attempts: " << attempts << ", userId: " << userId << std::endl;
-                        
-                        // Get min and max values if provided
-                        int min = 1;
-                        int max = 100;
-                        if (json.has("min")) min = json.i("min");
-                        if (json.has("max")) max = json.i("max");
-                        
-                        // In this simple implementation, gameId is the target number
-                        int targetNumber = gameId;
-                        
-                        JsonBuilder builder;
-                        builder.add("success", true);
-                        
-                        if (guess == targetNumber) {
-                            // Correct guess
-                            std::cout << "CORRECT GUESS! User: " << userId << ", Attempts: " << attempts << std::endl;
-                            bool saveSuccess = db.saveGame(userId, targetNumber, attempts, true);
-                            
-                            if (!saveSuccess) {
-                                std::cerr << "Failed to save game for user ID: " << userId << std::endl;
-                                // Even if save fails, we still want to tell the user they were correct
-                            } else {
-                                std::cout << "Successfully saved win to database!" << std::endl;
-                            }
-                            
-                            std::cout << "Sending correct=true in response" << std::endl;
-                            builder.add("message", "Correct!");
-                            builder.add("correct", true);
-                        } else {
-                            // Generate clue based on how close the guess is
-                            std::string clue = generateClue(guess, targetNumber, min, max);
-                            
-                            builder.add("message", clue);
-                            builder.add("correct", false);
-                        }
-                        
-                        response = createJsonResponse(builder.build());
-                    } else {
-                        JsonBuilder builder;
-                        builder.add("success", false)
-                               .add("message", "Invalid request - missing required parameters");
-                        
-                        response = createJsonResponse(builder.build());
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << "Error in guess handling: " << e.what() << std::endl;
-                    
-                    JsonBuilder errorBuilder;
-                    errorBuilder.add("success", false)
-                               .add("message", "An internal error occurred: " + std::string(e.what()));
-                    
-                    response = createJsonResponse(errorBuilder.build());
-                }
-            } else if (req.path == "/api/give-up" && req.method == "POST") {
-                // Handle give up
-                Json json(req.body);
-                if (json.has("gameId") && json.has("attempts") && json.has("user_id")) {
-                    int gameId = json.i("gameId");
-                    int attempts = json.i("attempts");
-                    int userId = json.i("user_id");
-                    
-                    // In this simple implementation, gameId is the target number
-                    int targetNumber = gameId;
-                    
-                    // Save the game as lost
-                    bool saveSuccess = db.saveGame(userId, targetNumber, attempts, false);
-                    
-                    JsonBuilder builder;
-                    if (saveSuccess) {
-                        builder.add("success", true)
-                               .add("targetNumber", targetNumber);
-                    } else {
-                        std::cerr << "Failed to save game after give up for user ID: " << userId << std::endl;
-                        builder.add("success", true) // Still return success to the client
-                               .add("targetNumber", targetNumber)
-                               .add("saveError", true); // Add a flag to indicate save error
-                    }
-                    
-                    response = createJsonResponse(builder.build());
+            }
+            
+            if (!waitForRequestData(clientSocket, deadline)) {
+                timedOut = true;
+                break;
+            }
+            int n = recv(clientSocket, buffer.tail(), static_cast<int>(buffer.space()), 0);
+            if (n <= 0) {
+                break;
+            }
+            buffer.commit(n);
+            parsed = parseHttpRequest(buffer.data(), buffer.size(), req, limits);
+        }
+        
+        if (buffer.size() > 0) {
+            HttpResponse response(clientSocket, responseBuffer);
+            if (parsed != ParseResult::Ok) {
+                std::cout << "Rejecting request: " << static_cast<int>(parsed) << std::endl;
+                if (overBudget) {
+                    response.error(HttpError::ServiceUnavailable);
+                } else if (timedOut) {
+                    response.error(HttpError::RequestTimeout);
+                } else if (parsed == ParseResult::HeadersTooLarge) {
+                    response.error(HttpError::HeaderFieldsTooLarge);
+                } else if (parsed == ParseResult::BodyTooLarge) {
+                    response.error(HttpError::PayloadTooLarge);
                 } else {
-                    JsonBuilder builder;
-                    builder.add("success", false)
-                           .add("message", "Invalid request");
-                    
-                    response = createJsonResponse(builder.build());
-                }
-            } else if (req.path == "/api/stats") {
-                // Get stats
-                try {
-                    if (req.query_params.count("user_id") > 0) {
-                        // Get user-specific stats
-                        int userId = std::stoi(req.query_params["user_id"]);
-                        Database::GameStats stats = db.getUserStats(userId);
-                        
-                        JsonBuilder builder;
-                        builder.add("totalGames", stats.total_games)
-                               .add("wins", stats.wins)
-                               .add("bestScore", stats.best_score)
-                               .add("avgAttempts", stats.avg_attempts);
-                        
-                        response = createJsonResponse(builder.build());
-                    } else {
-                        // Get global stats
-                        Database::GameStats stats = db.getStats();
-                        
-                        JsonBuilder builder;
-                        builder.add("totalGames", stats.total_games)
-                               .add("wins", stats.wins)
-                               .add("bestScore", stats.best_score)
-                               .add("avgAttempts", stats.avg_attempts);
-                        
-                        response = createJsonResponse(builder.build());
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << "Error fetching stats: " << e.what() << std::endl;
-                    
-                    // Return empty stats on error
-                    JsonBuilder builder;
-                    builder.add("totalGames", 0)
-                           .add("wins", 0)
-                           .add("bestScore", 0)
-                           .add("avgAttempts", 0.0);
-                    
-                    response = createJsonResponse(builder.build());
-                }
-            } else if (req.path == "/api/leaderboard") {
-                std::cout << "Handling leaderboard request..." << std::endl;
-                // Get leaderboard
-                try {
-                    std::cout << "Fetching leaderboard data..." << std::endl;
-                    std::vector<Database::LeaderboardEntry> leaderboard = db.getLeaderboard();
-                    std::cout << "Leaderboard fetched, entries: " << leaderboard.size() << std::endl;
-                    
-                    std::cout << "Creating leaderboard JSON..." << std::endl;
-                    std::string leaderboardJson = createLeaderboardJson(leaderboard);
-                    std::cout << "JSON created, size: " << leaderboardJson.size() << " bytes" << std::endl;
-                    
-                    response = createJsonResponse(leaderboardJson);
-                    std::cout << "Leaderboard response created" << std::endl;
-                } catch (const std::exception& e) {
-                    std::cerr << "Error fetching leaderboard: " << e.what() << std::endl;
-                    
-                    // Return empty array on error
-                    response = createJsonResponse("[]");
-                    std::cout << "Returned empty leaderboard due to error" << std::endl;
+                    response.error(HttpError::BadRequest);
                 }
+                response.finish();
+                CLOSE_SOCKET(clientSocket);
+                return;
+            }
+            
+            std::cout << "Request path: " << req.path << std::endl;
+            
+            // API responses follow the client's Accept header
+            response.setFormat(acceptedFormat(req));
+            
+            // Dispatch through the route table
+            const Route<RouteHandler>* route = kRoutes.find(req.method, req.path);
+            if (route) {
+                route->handler(req, db, response);
             } else {
                 // 404 for not found
-                response = create404Response();
+                response.notFound();
+            }
+            
+            // Event streams stay open; the room owns the socket now
+            if (response.handedOff()) {
+                std::cout << "Connection handed to event stream" << std::endl;
+                return;
             }
             
             // Send response
             std::cout << "Sending response..." << std::endl;
-            try {
-                if (send(clientSocket, response.c_str(), response.length(), 0) < 0) {
-                    std::cerr << "Failed to send response: " << SOCKET_ERROR_CODE << std::endl;
-                } else {
-                    std::cout << "Response sent successfully" << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Exception when sending response: " << e.what() << std::endl;
-            } catch (...) {
-                std::cerr << "Unknown exception when sending response" << std::endl;
+            if (response.finish()) {
+                std::cout << "Response sent successfully" << std::endl;
             }
         }
         
@@ -819,7 +1071,8 @@ void handleClient(socket_t clientSocket, Database& db) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    (void)argc;
     try {
         // Initialize socket library on Windows
 #ifdef _WIN32
@@ -829,6 +1082,8 @@ int main() {
             return 1;
         }
 #endif
+        HotUpgrade::installSignalHandlers();
+        HotUpgrade::resolveExecutable(argv[0]);
         
         std::cout << "Initializing database..." << std::endl;
         // Initialize database
@@ -839,55 +1094,129 @@ int main() {
         }
         std::cout << "Database initialized successfully" << std::endl;
         
-        std::cout << "Creating server socket..." << std::endl;
-        // Create server socket
-        socket_t serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-        if (serverSocket == INVALID_SOCKET) {
-            std::cerr << "Failed to create socket: " << SOCKET_ERROR_CODE << std::endl;
-            return 1;
-        }
+        int port = 8081;
         
-        // Set socket options to allow reuse
-        int opt = 1;
+        // When started by a hot upgrade, take over the previous process's listener
+        socket_t serverSocket = HotUpgrade::receiveListener();
+        if (serverSocket != INVALID_SOCKET) {
+            std::cout << "Inherited listening socket from previous process" << std::endl;
+        } else {
+            std::cout << "Creating server socket..." << std::endl;
+            // Create server socket
+            serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+            if (serverSocket == INVALID_SOCKET) {
+                std::cerr << "Failed to create socket: " << SOCKET_ERROR_CODE << std::endl;
+                return 1;
+            }
+#ifndef _WIN32
+            // Upgrades pass the listener explicitly, so don't leak it across exec
+            fcntl(serverSocket, F_SETFD, FD_CLOEXEC);
+#endif
+            
+            // Set socket options to allow reuse
+            int opt = 1;
 #ifdef _WIN32
-        if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt)) < 0) {
+            if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt)) < 0) {
 #else
-        if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+            if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
 #endif
-            std::cerr << "Failed to set socket options: " << SOCKET_ERROR_CODE << std::endl;
-            CLOSE_SOCKET(serverSocket);
-            return 1;
+                std::cerr << "Failed to set socket options: " << SOCKET_ERROR_CODE << std::endl;
+                CLOSE_SOCKET(serverSocket);
+                return 1;
+            }
+            
+            std::cout << "Setting up socket address..." << std::endl;
+            // Set up socket address
+            struct sockaddr_in serverAddr;
+            serverAddr.sin_family = AF_INET;
+            serverAddr.sin_addr.s_addr = INADDR_ANY;
+            serverAddr.sin_port = htons(port);
+            
+            std::cout << "Binding socket..." << std::endl;
+            // Bind socket
+            if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+                std::cerr << "Failed to bind socket: " << SOCKET_ERROR_CODE << std::endl;
+                CLOSE_SOCKET(serverSocket);
+                return 1;
+            }
+            
+            std::cout << "Listening on socket..." << std::endl;
+            // Listen for connections
+            // Room for connections that arrive while a request or an upgrade is in progress
+            if (listen(serverSocket, SOMAXCONN) < 0) {
+                std::cerr << "Failed to listen on socket: " << SOCKET_ERROR_CODE << std::endl;
+                CLOSE_SOCKET(serverSocket);
+                return 1;
+            }
         }
         
-        std::cout << "Setting up socket address..." << std::endl;
-        // Set up socket address
-        struct sockaddr_in serverAddr;
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_addr.s_addr = INADDR_ANY;
-        int port = 8081;
-        serverAddr.sin_port = htons(port);
+        // Low-latency TCP options, also reapplied to an inherited listener
+        SocketProfile socketProfile = SocketProfile::fromEnvironment();
+        socketProfile.applyToListener(serverSocket);
+        socketProfile.report(std::cout);
         
-        std::cout << "Binding socket..." << std::endl;
-        // Bind socket
-        if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-            std::cerr << "Failed to bind socket: " << SOCKET_ERROR_CODE << std::endl;
-            CLOSE_SOCKET(serverSocket);
-            return 1;
-        }
+        // Caps on request size and total request buffer memory
+        HttpLimits httpLimits = HttpLimits::fromEnvironment();
+        std::cout << "Request limits: headers " << httpLimits.maxHeaderBytes << " bytes / "
+                  << httpLimits.maxHeaderCount << " fields, body " << httpLimits.maxBodyBytes
+                  << " bytes, buffer budget " << httpLimits.bufferBudgetBytes << " bytes" << std::endl;
         
-        std::cout << "Listening on socket..." << std::endl;
-        // Listen for connections
-        if (listen(serverSocket, 10) < 0) {
-            std::cerr << "Failed to listen on socket: " << SOCKET_ERROR_CODE << std::endl;
-            CLOSE_SOCKET(serverSocket);
-            return 1;
+        std::cout << "Abandoned games expire after " << gameSessions.idleTimeout() << " seconds idle" << std::endl;
+        std::cout << "Rooms hold at most " << gameRooms.maxStreams() << " event streams" << std::endl;
+#ifndef _WIN32
+        openReserveDescriptor();
+#endif
+        
+        // Solve the built-in difficulties before taking traffic and the
+        // other small spans in the background
+        for (const DifficultyProfile& profile : kDifficultyProfiles) {
+            double expected = 0.0;
+            optimalPlay.solve(distanceBetween(profile.range.min, profile.range.max));
+            optimalPlay.lookup(distanceBetween(profile.range.min, profile.range.max), expected);
+            std::cout << "Optimal play on " << profile.name << " averages " << expected << " attempts" << std::endl;
         }
+        std::thread([] { optimalPlay.solveAll(); }).detach();
         
         std::cout << "Server running on port " << port << std::endl;
         std::cout << "Access the game at http://localhost:" << port << "/login.html" << std::endl;
+        takeOverLiveGames();
         
         // Server loop - no threading for now to simplify debugging
         while (true) {
+            // SIGUSR2: start a fresh binary on the same listener. This one keeps
+            // serving until it reports ready, then hands over its games and stops.
+            if (HotUpgrade::requested()) {
+                std::cout << "Upgrade requested..." << std::endl;
+                HotUpgrade::beginHandOff(serverSocket, argv);
+            }
+            
+            // Wake at least once a second to run the timers, and as soon as
+            // a new binary reports ready
+            struct pollfd polls[2];
+            polls[0].fd = serverSocket;
+            polls[0].events = POLLIN;
+            polls[0].revents = 0;
+            int pollCount = 1;
+            socket_t upgradeChannel = HotUpgrade::handOffChannel();
+            if (upgradeChannel != INVALID_SOCKET) {
+                polls[1].fd = upgradeChannel;
+                polls[1].events = POLLIN;
+                polls[1].revents = 0;
+                pollCount = 2;
+            }
+            int ready = POLL_SOCKETS(polls, pollCount, 1000);
+            HttpDate::refresh();
+            expireAbandonedGames(db);
+            heartbeatRooms();
+            if (HotUpgrade::handOffComplete()) {
+                // Requests are handled one at a time, so nothing is in flight here
+                handOverLiveGames();
+                break;
+            }
+            if (ready <= 0 || polls[0].revents == 0) {
+                continue;
+            }
+            
             struct sockaddr_in clientAddr;
             socklen_t clientAddrLen = sizeof(clientAddr);
             
@@ -895,14 +1224,32 @@ int main() {
             // Accept connection
             socket_t clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
             if (clientSocket == INVALID_SOCKET) {
-                std::cerr << "Failed to accept connection: " << SOCKET_ERROR_CODE << std::endl;
+                int error = SOCKET_ERROR_CODE;
+#ifndef _WIN32
+                if (error == EINTR) {
+                    continue;
+                }
+                if (error == EMFILE || error == ENFILE) {
+                    std::cerr << "Out of descriptors, shedding a connection" << std::endl;
+                    shedConnection(serverSocket);
+                    continue;
+                }
+#else
+                if (error == WSAEMFILE || error == WSAENOBUFS) {
+                    shedConnection(serverSocket);
+                    continue;
+                }
+#endif
+                std::cerr << "Failed to accept connection: " << error << std::endl;
                 continue;
             }
             
+            socketProfile.applyToClient(clientSocket);
+            
             std::cout << "Connection accepted, handling client..." << std::endl;
             // Handle client directly - no thread
             try {
-                handleClient(clientSocket, std::ref(db));
+                handleClient(clientSocket, std::ref(db), httpLimits);
                 std::cout << "Client handled successfully" << std::endl;
             } catch (const std::exception& e) {
                 std::cerr << "Exception in handleClient: " << e.what() << std::endl;
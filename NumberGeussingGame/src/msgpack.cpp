@@ -0,0 +1,327 @@
+#include "../include/msgpack.h"
+#include <cstring>
+
+namespace {
+
+void putBigEndian(std::string& out, std::uint64_t value, int bytes) {
+    char buffer[8];
+    for (int i = bytes - 1; i >= 0; i--) {
+        buffer[i] = static_cast<char>(value & 0xFF);
+        value >>= 8;
+    }
+    out.append(buffer, bytes);
+}
+
+void putTagged(std::string& out, unsigned char tag, std::uint64_t value, int bytes) {
+    out.push_back(static_cast<char>(tag));
+    putBigEndian(out, value, bytes);
+}
+
+bool readBigEndian(std::string_view data, std::size_t& pos, int bytes, std::uint64_t& value) {
+    if (data.size() - pos < static_cast<std::size_t>(bytes)) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+    }
+    pos += bytes;
+    return true;
+}
+
+// One decoded item header
+struct Head {
+    enum Kind { Scalar, String, Extension, Map, Array } kind = Scalar;
+    std::uint64_t length = 0;   // Payload bytes, or entries of a container
+    JsonValue value;            // For Scalar
+};
+
+bool readHead(std::string_view data, std::size_t& pos, Head& head) {
+    if (pos >= data.size()) {
+        return false;
+    }
+    unsigned char tag = static_cast<unsigned char>(data[pos++]);
+    std::uint64_t raw;
+
+    if (tag <= 0x7F) {
+        head.kind = Head::Scalar;
+        head.value = JsonValue::fromInteger(tag);
+        return true;
+    }
+    if (tag >= 0xE0) {
+        head.kind = Head::Scalar;
+        head.value = JsonValue::fromInteger(static_cast<std::int8_t>(tag));
+        return true;
+    }
+    if (tag <= 0x8F) {
+        head.kind = Head::Map;
+        head.length = tag & 0x0F;
+        return true;
+    }
+    if (tag <= 0x9F) {
+        head.kind = Head::Array;
+        head.length = tag & 0x0F;
+        return true;
+    }
+    if (tag <= 0xBF) {
+        head.kind = Head::String;
+        head.length = tag & 0x1F;
+        return true;
+    }
+
+    switch (tag) {
+        case 0xC0:
+            head.kind = Head::Scalar;
+            head.value = JsonValue(JsonType::Null, "null", false);
+            return true;
+        case 0xC2:
+        case 0xC3:
+            head.kind = Head::Scalar;
+            head.value = JsonValue(JsonType::Boolean, tag == 0xC3 ? "true" : "false", false);
+            return true;
+        // bin 8/16/32 and str 8/16/32
+        case 0xC4: case 0xD9:
+            head.kind = Head::String;
+            return readBigEndian(data, pos, 1, head.length);
+        case 0xC5: case 0xDA:
+            head.kind = Head::String;
+            return readBigEndian(data, pos, 2, head.length);
+        case 0xC6: case 0xDB:
+            head.kind = Head::String;
+            return readBigEndian(data, pos, 4, head.length);
+        case 0xCA: {
+            if (!readBigEndian(data, pos, 4, raw)) return false;
+            std::uint32_t bits = static_cast<std::uint32_t>(raw);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            head.kind = Head::Scalar;
+            head.value = JsonValue::fromReal(value);
+            return true;
+        }
+        case 0xCB: {
+            if (!readBigEndian(data, pos, 8, raw)) return false;
+            double value;
+            std::memcpy(&value, &raw, sizeof(value));
+            head.kind = Head::Scalar;
+            head.value = JsonValue::fromReal(value);
+            return true;
+        }
+        case 0xCC: case 0xCD: case 0xCE: case 0xCF: {
+            if (!readBigEndian(data, pos, 1 << (tag - 0xCC), raw)) return false;
+            head.kind = Head::Scalar;
+            // Beyond int64 it can only be held approximately
+            head.value = raw > static_cast<std::uint64_t>(INT64_MAX)
+                ? JsonValue::fromReal(static_cast<double>(raw))
+                : JsonValue::fromInteger(static_cast<std::int64_t>(raw));
+            return true;
+        }
+        case 0xD0: case 0xD1: case 0xD2: case 0xD3: {
+            int bytes = 1 << (tag - 0xD0);
+            if (!readBigEndian(data, pos, bytes, raw)) return false;
+            // Sign-extend from the encoded width
+            int shift = 64 - 8 * bytes;
+            std::int64_t value = static_cast<std::int64_t>(raw << shift) >> shift;
+            head.kind = Head::Scalar;
+            head.value = JsonValue::fromInteger(value);
+            return true;
+        }
+        case 0xDC: case 0xDD:
+            head.kind = Head::Array;
+            return readBigEndian(data, pos, tag == 0xDC ? 2 : 4, head.length);
+        case 0xDE: case 0xDF:
+            head.kind = Head::Map;
+            return readBigEndian(data, pos, tag == 0xDE ? 2 : 4, head.length);
+        // fixext 1/2/4/8/16 and ext 8/16/32: skipped, read as null
+        case 0xD4: case 0xD5: case 0xD6: case 0xD7: case 0xD8:
+            head.kind = Head::Extension;
+            head.length = 1 + (std::uint64_t(1) << (tag - 0xD4));
+            return true;
+        case 0xC7: case 0xC8: case 0xC9: {
+            if (!readBigEndian(data, pos, 1 << (tag - 0xC7), head.length)) return false;
+            head.kind = Head::Extension;
+            head.length += 1;   // Type byte
+            return true;
+        }
+        default:
+            return false;   // 0xC1 is never used
+    }
+}
+
+// Skip one complete item, nested containers included, without recursion
+bool skipItem(std::string_view data, std::size_t& pos) {
+    std::uint64_t pending = 1;
+    while (pending > 0) {
+        pending--;
+        Head head;
+        if (!readHead(data, pos, head)) {
+            return false;
+        }
+        if (head.kind == Head::String || head.kind == Head::Extension) {
+            if (data.size() - pos < head.length) return false;
+            pos += head.length;
+        } else if (head.kind == Head::Map) {
+            pending += 2 * head.length;
+        } else if (head.kind == Head::Array) {
+            pending += head.length;
+        }
+        // Every item takes at least one byte
+        if (pending > data.size() - pos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readValue(std::string_view data, std::size_t& pos, JsonValue& value) {
+    std::size_t start = pos;
+    Head head;
+    if (!readHead(data, pos, head)) {
+        return false;
+    }
+    switch (head.kind) {
+        case Head::Scalar:
+            value = head.value;
+            return true;
+        case Head::String:
+            if (data.size() - pos < head.length) return false;
+            value = JsonValue(JsonType::String, data.substr(pos, head.length), false);
+            pos += head.length;
+            return true;
+        case Head::Extension:
+            if (data.size() - pos < head.length) return false;
+            value = JsonValue(JsonType::Null, "null", false);
+            pos += head.length;
+            return true;
+        case Head::Map:
+        case Head::Array:
+            pos = start;
+            if (!skipItem(data, pos)) return false;
+            value = JsonValue(head.kind == Head::Map ? JsonType::Object : JsonType::Array,
+                              data.substr(start, pos - start), false);
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void appendMsgPackString(std::string& out, std::string_view text) {
+    std::size_t length = text.size();
+    if (length <= 31) {
+        out.push_back(static_cast<char>(0xA0 | length));
+    } else if (length <= 0xFF) {
+        putTagged(out, 0xD9, length, 1);
+    } else if (length <= 0xFFFF) {
+        putTagged(out, 0xDA, length, 2);
+    } else {
+        putTagged(out, 0xDB, length, 4);
+    }
+    out.append(text);
+}
+
+void appendMsgPackInt(std::string& out, std::int64_t value) {
+    if (value >= 0) {
+        std::uint64_t u = static_cast<std::uint64_t>(value);
+        if (u <= 0x7F) {
+            out.push_back(static_cast<char>(u));
+        } else if (u <= 0xFF) {
+            putTagged(out, 0xCC, u, 1);
+        } else if (u <= 0xFFFF) {
+            putTagged(out, 0xCD, u, 2);
+        } else if (u <= 0xFFFFFFFF) {
+            putTagged(out, 0xCE, u, 4);
+        } else {
+            putTagged(out, 0xCF, u, 8);
+        }
+        return;
+    }
+    if (value >= -32) {
+        out.push_back(static_cast<char>(value));
+    } else if (value >= INT8_MIN) {
+        putTagged(out, 0xD0, static_cast<std::uint64_t>(value), 1);
+    } else if (value >= INT16_MIN) {
+        putTagged(out, 0xD1, static_cast<std::uint64_t>(value), 2);
+    } else if (value >= INT32_MIN) {
+        putTagged(out, 0xD2, static_cast<std::uint64_t>(value), 4);
+    } else {
+        putTagged(out, 0xD3, static_cast<std::uint64_t>(value), 8);
+    }
+}
+
+void appendMsgPackDouble(std::string& out, double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putTagged(out, 0xCB, bits, 8);
+}
+
+void appendMsgPackBool(std::string& out, bool value) {
+    out.push_back(static_cast<char>(value ? 0xC3 : 0xC2));
+}
+
+void appendMsgPackNil(std::string& out) {
+    out.push_back(static_cast<char>(0xC0));
+}
+
+void appendMsgPackArrayHeader(std::string& out, std::uint32_t count) {
+    if (count <= 15) {
+        out.push_back(static_cast<char>(0x90 | count));
+    } else if (count <= 0xFFFF) {
+        putTagged(out, 0xDC, count, 2);
+    } else {
+        putTagged(out, 0xDD, count, 4);
+    }
+}
+
+void appendMsgPackMapHeader(std::string& out, std::uint32_t count) {
+    if (count <= 15) {
+        out.push_back(static_cast<char>(0x80 | count));
+    } else if (count <= 0xFFFF) {
+        putTagged(out, 0xDE, count, 2);
+    } else {
+        putTagged(out, 0xDF, count, 4);
+    }
+}
+
+// End of the map at pos; the input must end there too
+bool MsgPackReader::finish() {
+    finished = true;
+    if (pos != data.size()) {
+        return fail();
+    }
+    return false;
+}
+
+bool MsgPackReader::next(JsonField& field) {
+    if (failed || finished) {
+        return false;
+    }
+
+    if (!started) {
+        started = true;
+        Head head;
+        if (!readHead(data, pos, head) || head.kind != Head::Map) {
+            return fail();
+        }
+        if (head.length > data.size() - pos) {
+            return fail();
+        }
+        remaining = static_cast<std::uint32_t>(head.length);
+    }
+    if (remaining == 0) {
+        return finish();
+    }
+    remaining--;
+
+    Head key;
+    if (!readHead(data, pos, key) || key.kind != Head::String || data.size() - pos < key.length) {
+        return fail();
+    }
+    field.key = data.substr(pos, key.length);
+    field.keyEscaped = false;
+    pos += key.length;
+
+    if (!readValue(data, pos, field.value)) {
+        return fail();
+    }
+    return true;
+}
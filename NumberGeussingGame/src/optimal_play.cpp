@@ -0,0 +1,78 @@
+#include "../include/optimal_play.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+double optimalExpectedAttempts(std::uint64_t span, const ClueThresholds& thresholds) {
+    const int n = static_cast<int>(span) + 1;
+    ClueLimits limits(span, thresholds);
+
+    // Distances [nearest, farthest] that give each band; a band may be empty
+    int nearest[5];
+    int farthest[5];
+    for (int band = 0; band < 5; band++) {
+        nearest[band] = band == 0 ? 1 : static_cast<int>(limits.limit[band - 1]) + 1;
+        farthest[band] = band == 4 ? n : static_cast<int>(limits.limit[band]);
+    }
+
+    // total[a * n + b]: attempts summed over every target in [a, b] under
+    // the best strategy for that interval
+    std::vector<std::uint32_t> total(static_cast<std::size_t>(n) * n, 0);
+    const std::uint32_t unsolvable = std::numeric_limits<std::uint32_t>::max();
+
+    for (int length = 1; length <= n; length++) {
+        for (int a = 0; a + length <= n; a++) {
+            int b = a + length - 1;
+            std::uint32_t best = unsolvable;
+
+            for (int guess = 0; guess < n; guess++) {
+                std::uint32_t cost = static_cast<std::uint32_t>(length);
+                bool progress = true;
+                for (int band = 0; band < 5 && progress; band++) {
+                    // Targets above, then below, the guess that fall in this band
+                    int ranges[2][2] = {
+                        {std::max(a, guess + nearest[band]), std::min(b, guess + farthest[band])},
+                        {std::max(a, guess - farthest[band]), std::min(b, guess - nearest[band])},
+                    };
+                    for (const auto& range : ranges) {
+                        int lo = range[0];
+                        int hi = range[1];
+                        if (lo > hi) continue;
+                        if (lo == a && hi == b) {
+                            progress = false;   // This guess tells nothing about [a, b]
+                            break;
+                        }
+                        cost += total[static_cast<std::size_t>(lo) * n + hi];
+                    }
+                }
+                if (progress && cost < best) {
+                    best = cost;
+                }
+            }
+            total[static_cast<std::size_t>(a) * n + b] = best;
+        }
+    }
+    return static_cast<double>(total[n - 1]) / n;
+}
+
+// One thread solves at a time: startup, then the background thread
+void OptimalPlayCache::solve(std::uint64_t span) {
+    if (!solved[span].load(std::memory_order_acquire)) {
+        bySpan[span] = optimalExpectedAttempts(span);
+        solved[span].store(true, std::memory_order_release);
+    }
+}
+
+void OptimalPlayCache::solveAll() {
+    for (std::uint64_t span = 1; span <= kOptimalPlayMaxSpan; span++) {
+        solve(span);
+    }
+}
+
+bool OptimalPlayCache::lookup(std::uint64_t span, double& expected) const {
+    if (span > kOptimalPlayMaxSpan || !solved[span].load(std::memory_order_acquire)) {
+        return false;
+    }
+    expected = bySpan[span];
+    return true;
+}
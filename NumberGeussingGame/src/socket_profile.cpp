@@ -0,0 +1,119 @@
+#include "../include/socket_profile.h"
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <netinet/tcp.h>
+#endif
+
+namespace {
+
+int envInt(const char* name, int fallback) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) return fallback;
+    return std::atoi(value);
+}
+
+bool setIntOption(socket_t sock, int level, int option, int value, const char* label) {
+#ifdef _WIN32
+    int rc = setsockopt(sock, level, option, (const char*)&value, sizeof(value));
+#else
+    int rc = setsockopt(sock, level, option, &value, sizeof(value));
+#endif
+    if (rc < 0) {
+        std::cerr << "Failed to set " << label << ": " << SOCKET_ERROR_CODE << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+SocketProfile SocketProfile::fromEnvironment() {
+    SocketProfile profile;
+
+    const char* name = std::getenv("NGG_SOCKET_PROFILE");
+    if (name && std::strcmp(name, "default") == 0) {
+        profile.name = "default";
+        profile.noDelay = false;
+        profile.quickAck = false;
+        profile.deferAcceptSeconds = 0;
+        profile.fastOpenQueue = 0;
+        profile.busyPollMicros = 0;
+    }
+
+    profile.noDelay = envInt("NGG_TCP_NODELAY", profile.noDelay) != 0;
+    profile.quickAck = envInt("NGG_TCP_QUICKACK", profile.quickAck) != 0;
+    profile.deferAcceptSeconds = envInt("NGG_TCP_DEFER_ACCEPT", profile.deferAcceptSeconds);
+    profile.fastOpenQueue = envInt("NGG_TCP_FASTOPEN", profile.fastOpenQueue);
+    profile.busyPollMicros = envInt("NGG_SO_BUSY_POLL", profile.busyPollMicros);
+    return profile;
+}
+
+void SocketProfile::applyToListener(socket_t listener) const {
+#ifdef TCP_DEFER_ACCEPT
+    if (deferAcceptSeconds > 0) {
+        setIntOption(listener, IPPROTO_TCP, TCP_DEFER_ACCEPT, deferAcceptSeconds, "TCP_DEFER_ACCEPT");
+    }
+#endif
+#ifdef TCP_FASTOPEN
+    if (fastOpenQueue > 0) {
+        setIntOption(listener, IPPROTO_TCP, TCP_FASTOPEN, fastOpenQueue, "TCP_FASTOPEN");
+    }
+#endif
+#ifdef SO_BUSY_POLL
+    if (busyPollMicros > 0) {
+        setIntOption(listener, SOL_SOCKET, SO_BUSY_POLL, busyPollMicros, "SO_BUSY_POLL");
+    }
+#endif
+    (void)listener;
+}
+
+void SocketProfile::applyToClient(socket_t client) const {
+    if (noDelay) {
+        setIntOption(client, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    }
+#ifdef TCP_QUICKACK
+    // Not sticky on Linux, so set it right before the first recv()
+    if (quickAck) {
+        setIntOption(client, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+    }
+#endif
+#ifdef SO_BUSY_POLL
+    if (busyPollMicros > 0) {
+        setIntOption(client, SOL_SOCKET, SO_BUSY_POLL, busyPollMicros, "SO_BUSY_POLL");
+    }
+#endif
+}
+
+void SocketProfile::report(std::ostream& out) const {
+    auto unsupported = [](bool supported) { return supported ? "" : " (unsupported)"; };
+
+#ifdef TCP_QUICKACK
+    const bool hasQuickAck = true;
+#else
+    const bool hasQuickAck = false;
+#endif
+#ifdef TCP_DEFER_ACCEPT
+    const bool hasDeferAccept = true;
+#else
+    const bool hasDeferAccept = false;
+#endif
+#ifdef TCP_FASTOPEN
+    const bool hasFastOpen = true;
+#else
+    const bool hasFastOpen = false;
+#endif
+#ifdef SO_BUSY_POLL
+    const bool hasBusyPoll = true;
+#else
+    const bool hasBusyPoll = false;
+#endif
+
+    out << "Socket profile: " << name << std::endl;
+    out << "  TCP_NODELAY: " << (noDelay ? "on" : "off") << std::endl;
+    out << "  TCP_QUICKACK: " << (quickAck ? "on" : "off") << unsupported(hasQuickAck) << std::endl;
+    out << "  TCP_DEFER_ACCEPT: " << deferAcceptSeconds << "s" << unsupported(hasDeferAccept) << std::endl;
+    out << "  TCP_FASTOPEN: queue " << fastOpenQueue << unsupported(hasFastOpen) << std::endl;
+    out << "  SO_BUSY_POLL: " << busyPollMicros << "us" << unsupported(hasBusyPoll) << std::endl;
+}
@@ -0,0 +1,217 @@
+#include "../include/wire_format.h"
+#include "../include/cbor.h"
+#include "../include/json.h"
+#include "../include/msgpack.h"
+#include <charconv>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Media type to format; false for types the API does not speak
+bool formatForMediaType(std::string_view type, WireFormat& format) {
+    if (equalsIgnoreCase(type, "application/json") || equalsIgnoreCase(type, "application/*") ||
+        type == "*/*") {
+        format = WireFormat::Json;
+        return true;
+    }
+    if (equalsIgnoreCase(type, "application/msgpack") || equalsIgnoreCase(type, "application/x-msgpack") ||
+        equalsIgnoreCase(type, "application/vnd.msgpack")) {
+        format = WireFormat::MessagePack;
+        return true;
+    }
+    if (equalsIgnoreCase(type, "application/cbor")) {
+        format = WireFormat::Cbor;
+        return true;
+    }
+    return false;
+}
+
+// Quality of one media range's parameters, 1 when q is absent
+double qualityOf(std::string_view parameters) {
+    while (!parameters.empty()) {
+        std::size_t semicolon = parameters.find(';');
+        std::string_view parameter = trim(parameters.substr(0, semicolon));
+        parameters = semicolon == std::string_view::npos ? std::string_view() : parameters.substr(semicolon + 1);
+
+        if (parameter.size() > 2 && (parameter[0] == 'q' || parameter[0] == 'Q') && parameter[1] == '=') {
+            double quality = 0.0;
+            const char* end = parameter.data() + parameter.size();
+            auto result = std::from_chars(parameter.data() + 2, end, quality);
+            return result.ec == std::errc() ? quality : 0.0;
+        }
+    }
+    return 1.0;
+}
+
+} // namespace
+
+WireFormat acceptedFormat(std::string_view accept) {
+    WireFormat best = WireFormat::Json;
+    double bestQuality = 0.0;
+
+    while (!accept.empty()) {
+        std::size_t comma = accept.find(',');
+        std::string_view range = accept.substr(0, comma);
+        accept = comma == std::string_view::npos ? std::string_view() : accept.substr(comma + 1);
+
+        std::size_t semicolon = range.find(';');
+        std::string_view type = trim(range.substr(0, semicolon));
+        double quality = semicolon == std::string_view::npos ? 1.0 : qualityOf(range.substr(semicolon + 1));
+
+        // Earlier ranges win ties
+        WireFormat format;
+        if (quality > bestQuality && formatForMediaType(type, format)) {
+            best = format;
+            bestQuality = quality;
+        }
+    }
+    return best;
+}
+
+WireFormat bodyFormat(std::string_view contentType) {
+    WireFormat format = WireFormat::Json;
+    std::string_view type = trim(contentType.substr(0, contentType.find(';')));
+    if (!formatForMediaType(type, format)) {
+        format = WireFormat::Json;
+    }
+    return format;
+}
+
+ObjectBuilder::ObjectBuilder(std::string& out, WireFormat format)
+    : out(out), format(format), start(out.size()) {
+    switch (format) {
+        case WireFormat::Json: out.push_back('{'); break;
+        case WireFormat::MessagePack: appendMsgPackMapHeader(out, 0); break;   // Patched by build()
+        case WireFormat::Cbor: appendCborMapStart(out); break;
+    }
+}
+
+void ObjectBuilder::addKey(std::string_view key) {
+    switch (format) {
+        case WireFormat::Json:
+            if (count > 0) {
+                out.push_back(',');
+            }
+            appendJsonString(out, key);
+            out.push_back(':');
+            break;
+        case WireFormat::MessagePack:
+            appendMsgPackString(out, key);
+            break;
+        case WireFormat::Cbor:
+            appendCborString(out, key);
+            break;
+    }
+    count++;
+}
+
+ObjectBuilder& ObjectBuilder::add(std::string_view key, std::string_view value) {
+    addKey(key);
+    switch (format) {
+        case WireFormat::Json: appendJsonString(out, value); break;
+        case WireFormat::MessagePack: appendMsgPackString(out, value); break;
+        case WireFormat::Cbor: appendCborString(out, value); break;
+    }
+    return *this;
+}
+
+ObjectBuilder& ObjectBuilder::add(std::string_view key, std::int64_t value) {
+    addKey(key);
+    switch (format) {
+        case WireFormat::Json: appendJsonNumber(out, value); break;
+        case WireFormat::MessagePack: appendMsgPackInt(out, value); break;
+        case WireFormat::Cbor: appendCborInt(out, value); break;
+    }
+    return *this;
+}
+
+ObjectBuilder& ObjectBuilder::add(std::string_view key, double value) {
+    addKey(key);
+    switch (format) {
+        case WireFormat::Json: appendJsonNumber(out, value); break;
+        case WireFormat::MessagePack: appendMsgPackDouble(out, value); break;
+        case WireFormat::Cbor: appendCborDouble(out, value); break;
+    }
+    return *this;
+}
+
+ObjectBuilder& ObjectBuilder::add(std::string_view key, bool value) {
+    addKey(key);
+    switch (format) {
+        case WireFormat::Json: out.append(value ? "true" : "false"); break;
+        case WireFormat::MessagePack: appendMsgPackBool(out, value); break;
+        case WireFormat::Cbor: appendCborBool(out, value); break;
+    }
+    return *this;
+}
+
+ObjectBuilder& ObjectBuilder::addEncoded(std::string_view encoded, std::uint32_t pairs) {
+    if (format == WireFormat::Json && count > 0) {
+        out.push_back(',');
+    }
+    out.append(encoded);
+    count += pairs;
+    return *this;
+}
+
+void ObjectBuilder::build() {
+    switch (format) {
+        case WireFormat::Json:
+            out.push_back('}');
+            break;
+        case WireFormat::MessagePack:
+            if (count <= 15) {
+                out[start] = static_cast<char>(0x80 | count);
+            } else {
+                // Rare: widen the placeholder to a map 16/32 header
+                std::string header;
+                appendMsgPackMapHeader(header, count);
+                out.replace(start, 1, header);
+            }
+            break;
+        case WireFormat::Cbor:
+            appendCborBreak(out);
+            break;
+    }
+}
+
+ArrayBuilder::ArrayBuilder(std::string& out, WireFormat format, std::uint32_t count)
+    : out(out), format(format), count(count) {
+    switch (format) {
+        case WireFormat::Json: out.push_back('['); break;
+        case WireFormat::MessagePack: appendMsgPackArrayHeader(out, count); break;
+        case WireFormat::Cbor: appendCborArrayStart(out); break;
+    }
+}
+
+void ArrayBuilder::item() {
+    if (format == WireFormat::Json && items > 0) {
+        out.push_back(',');
+    }
+    items++;
+}
+
+void ArrayBuilder::build() {
+    switch (format) {
+        case WireFormat::Json:
+            out.push_back(']');
+            break;
+        case WireFormat::MessagePack:
+            for (; items < count; items++) {
+                appendMsgPackNil(out);
+            }
+            break;
+        case WireFormat::Cbor:
+            appendCborBreak(out);
+            break;
+    }
+}
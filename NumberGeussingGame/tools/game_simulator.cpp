@@ -0,0 +1,337 @@
+// Monte-Carlo simulator for calibrating the hot/cold clue bands.
+//
+// Plays millions of games per difficulty against the server's own clue code
+// (game_rules.h) with several guessing strategies and reports the
+// distribution of attempts for each clue threshold setting. Every core runs
+// its own batch of games in lockstep: one guess per game, then the whole
+// batch is classified with classifyDistances().
+//
+// Usage: GameSimulator [--games N] [--threads N] [--strategy NAME]
+//                      [--thresholds A,B,C,D]... [--range MIN:MAX] [--histogram]
+//
+// Strategies: binary (halve on higher/lower), clue (also narrow by the
+// band), random (uniform pick from what higher/lower leaves). An "optimal"
+// row gives the expected attempts of perfect play for comparison. Thresholds
+// are the band edges in percent of the range; 5,10,20,40 is the server's.
+// --range replaces the built-in difficulties with a single custom range,
+// and --histogram adds the share of games won at each attempt count.
+
+#include "../include/fast_random.h"
+#include "../include/game_rules.h"
+#include "../include/optimal_play.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kBatchGames = 256;
+constexpr std::size_t kHistogramSize = 130;    // Last bucket: that many attempts or more
+constexpr std::uint32_t kGiveUpAttempts = 10000;
+
+// Values the target can still take, given every clue so far
+struct Interval {
+    std::int64_t lo;
+    std::int64_t hi;
+};
+
+// lo + (hi - lo) / 2 without overflow
+std::int64_t midpoint(const Interval& candidates) {
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(candidates.lo) +
+                                     distanceBetween(candidates.lo, candidates.hi) / 2);
+}
+
+std::int64_t binaryGuess(const Interval& candidates, Xoshiro256&) {
+    return midpoint(candidates);
+}
+
+std::int64_t randomGuess(const Interval& candidates, Xoshiro256& random) {
+    std::uint64_t span = distanceBetween(candidates.lo, candidates.hi) + 1;
+    std::uint64_t offset = span == 0 ? random.next() : boundedRandom(random, span);
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(candidates.lo) + offset);
+}
+
+struct Strategy {
+    const char* name;
+    std::int64_t (*guess)(const Interval& candidates, Xoshiro256& random);
+    bool usesBands;     // Narrow by distance band as well as direction
+};
+
+const Strategy kStrategies[] = {
+    {"binary", binaryGuess, false},
+    {"clue", binaryGuess, true},
+    {"random", randomGuess, false},
+};
+
+// value + offset (or - offset), clamped to the int64 range
+std::int64_t offsetBy(std::int64_t value, std::uint64_t offset, bool up) {
+    std::uint64_t room = up ? distanceBetween(value, INT64_MAX) : distanceBetween(INT64_MIN, value);
+    if (offset >= room) {
+        return up ? INT64_MAX : INT64_MIN;
+    }
+    std::uint64_t base = static_cast<std::uint64_t>(value);
+    return static_cast<std::int64_t>(up ? base + offset : base - offset);
+}
+
+// Shrink candidates after a miss. The direction puts the target on one side
+// of the guess; the band, if used, bounds its distance to (limit[b-1], limit[b]].
+void narrow(Interval& candidates, std::int64_t guess, bool higher, Clue clue, const ClueLimits& limits,
+            bool usesBands) {
+    std::uint64_t nearest = 1;
+    std::uint64_t farthest = UINT64_MAX;
+    if (usesBands) {
+        int band = static_cast<int>(clue) - static_cast<int>(Clue::VeryHot);
+        if (band > 0 && limits.limit[band - 1] < UINT64_MAX) {
+            nearest = limits.limit[band - 1] + 1;
+        }
+        if (band < 4) {
+            farthest = limits.limit[band];
+        }
+    }
+    if (higher) {
+        candidates.lo = std::max(candidates.lo, offsetBy(guess, nearest, true));
+        candidates.hi = std::min(candidates.hi, offsetBy(guess, farthest, true));
+    } else {
+        candidates.hi = std::min(candidates.hi, offsetBy(guess, nearest, false));
+        candidates.lo = std::max(candidates.lo, offsetBy(guess, farthest, false));
+    }
+}
+
+struct SimulationResult {
+    std::vector<std::uint64_t> histogram = std::vector<std::uint64_t>(kHistogramSize);
+    std::uint64_t games = 0;
+    std::uint64_t totalAttempts = 0;
+    std::uint32_t maxAttempts = 0;
+
+    void record(std::uint32_t attempts) {
+        histogram[std::min<std::size_t>(attempts, kHistogramSize - 1)]++;
+        games++;
+        totalAttempts += attempts;
+        maxAttempts = std::max(maxAttempts, attempts);
+    }
+
+    void merge(const SimulationResult& other) {
+        for (std::size_t i = 0; i < kHistogramSize; i++) {
+            histogram[i] += other.histogram[i];
+        }
+        games += other.games;
+        totalAttempts += other.totalAttempts;
+        maxAttempts = std::max(maxAttempts, other.maxAttempts);
+    }
+
+    // Smallest attempt count reached by at least share of the games
+    std::uint32_t percentile(double share) const {
+        std::uint64_t wanted = static_cast<std::uint64_t>(share * games);
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kHistogramSize; i++) {
+            seen += histogram[i];
+            if (seen >= wanted && seen > 0) {
+                return static_cast<std::uint32_t>(i);
+            }
+        }
+        return static_cast<std::uint32_t>(kHistogramSize - 1);
+    }
+};
+
+// Play games games on one thread, kBatchGames at a time in lockstep
+SimulationResult simulate(const Strategy& strategy, const DifficultyRange& range,
+                          const ClueThresholds& thresholds, std::uint64_t games) {
+    SimulationResult result;
+    Xoshiro256 random = Xoshiro256::fromOs();
+    ClueLimits limits(distanceBetween(range.min, range.max), thresholds);
+
+    Interval candidates[kBatchGames];
+    std::int64_t targets[kBatchGames];
+    std::int64_t guesses[kBatchGames];
+    std::uint64_t diffs[kBatchGames];
+    Clue clues[kBatchGames];
+    std::uint32_t attempts[kBatchGames];
+
+    std::uint64_t started = 0;
+    std::size_t active = 0;
+    auto startGame = [&](std::size_t i) {
+        candidates[i] = {range.min, range.max};
+        targets[i] = randomGuess(candidates[i], random);
+        attempts[i] = 0;
+        started++;
+    };
+    while (active < kBatchGames && started < games) {
+        startGame(active++);
+    }
+
+    while (active > 0) {
+        for (std::size_t i = 0; i < active; i++) {
+            guesses[i] = strategy.guess(candidates[i], random);
+            diffs[i] = distanceBetween(guesses[i], targets[i]);
+        }
+        classifyDistances(limits, diffs, active, clues);
+
+        for (std::size_t i = 0; i < active;) {
+            attempts[i]++;
+            if (clues[i] != Clue::Correct && attempts[i] < kGiveUpAttempts) {
+                narrow(candidates[i], guesses[i], guesses[i] < targets[i], clues[i], limits, strategy.usesBands);
+                i++;
+                continue;
+            }
+            result.record(attempts[i]);
+            if (started < games) {
+                startGame(i);
+                i++;
+                continue;
+            }
+            // Out of games: move the last one, not yet stepped, into this slot
+            active--;
+            candidates[i] = candidates[active];
+            targets[i] = targets[active];
+            guesses[i] = guesses[active];
+            clues[i] = clues[active];
+            attempts[i] = attempts[active];
+        }
+    }
+    return result;
+}
+
+bool parseThresholds(const char* text, ClueThresholds& thresholds) {
+    std::uint32_t previous = 0;
+    for (int i = 0; i < 4; i++) {
+        char* end = nullptr;
+        unsigned long value = std::strtoul(text, &end, 10);
+        if (end == text || value < previous || value > 100 || *end != (i < 3 ? ',' : '\0')) {
+            return false;
+        }
+        thresholds.percent[i] = static_cast<std::uint32_t>(value);
+        previous = thresholds.percent[i];
+        text = end + 1;
+    }
+    return true;
+}
+
+bool parseRange(const char* text, DifficultyRange& range) {
+    char* end = nullptr;
+    range.min = std::strtoll(text, &end, 10);
+    if (end == text || *end != ':') {
+        return false;
+    }
+    const char* maxText = end + 1;
+    range.max = std::strtoll(maxText, &end, 10);
+    return end != maxText && *end == '\0' && range.min < range.max;
+}
+
+void printUsage() {
+    std::cerr << "Usage: GameSimulator [--games N] [--threads N] [--strategy binary|clue|random]\n"
+              << "                     [--thresholds A,B,C,D]... [--range MIN:MAX] [--histogram]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::uint64_t games = 1000000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* onlyStrategy = nullptr;
+    bool showHistogram = false;
+    std::vector<ClueThresholds> thresholdSets;
+    std::vector<DifficultyProfile> difficulties(std::begin(kDifficultyProfiles), std::end(kDifficultyProfiles));
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--games") == 0 && hasValue) {
+            games = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+        } else if (std::strcmp(argv[i], "--strategy") == 0 && hasValue) {
+            onlyStrategy = argv[++i];
+        } else if (std::strcmp(argv[i], "--thresholds") == 0 && hasValue) {
+            ClueThresholds thresholds;
+            if (!parseThresholds(argv[++i], thresholds)) {
+                std::cerr << "Thresholds must be four ascending percentages, e.g. 5,10,20,40" << std::endl;
+                return 1;
+            }
+            thresholdSets.push_back(thresholds);
+        } else if (std::strcmp(argv[i], "--range") == 0 && hasValue) {
+            DifficultyRange range;
+            if (!parseRange(argv[++i], range)) {
+                std::cerr << "Range must be MIN:MAX with MIN below MAX" << std::endl;
+                return 1;
+            }
+            difficulties = {{"custom", range}};
+        } else if (std::strcmp(argv[i], "--histogram") == 0) {
+            showHistogram = true;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (thresholdSets.empty()) {
+        thresholdSets.push_back(kDefaultClueThresholds);
+    }
+
+    std::cout << "Simulating " << games << " games per row on " << threads << " threads" << std::endl;
+    std::cout << std::left << std::setw(10) << "range" << std::setw(14) << "thresholds" << std::setw(8) << "strategy"
+              << std::right << std::setw(8) << "mean" << std::setw(6) << "p50" << std::setw(6) << "p90"
+              << std::setw(6) << "p99" << std::setw(7) << "max" << std::setw(12) << "games/s" << std::endl;
+
+    for (const DifficultyProfile& difficulty : difficulties) {
+        for (const ClueThresholds& thresholds : thresholdSets) {
+            std::string thresholdText;
+            for (int i = 0; i < 4; i++) {
+                thresholdText += (i ? "," : "") + std::to_string(thresholds.percent[i]);
+            }
+
+            for (const Strategy& strategy : kStrategies) {
+                if (onlyStrategy && std::strcmp(onlyStrategy, strategy.name) != 0) {
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                std::vector<SimulationResult> partial(threads);
+                std::vector<std::thread> workers;
+                for (unsigned t = 0; t < threads; t++) {
+                    std::uint64_t share = games / threads + (t < games % threads ? 1 : 0);
+                    workers.emplace_back([&, t, share] {
+                        partial[t] = simulate(strategy, difficulty.range, thresholds, share);
+                    });
+                }
+                SimulationResult total;
+                for (unsigned t = 0; t < threads; t++) {
+                    workers[t].join();
+                    total.merge(partial[t]);
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                double mean = total.games ? static_cast<double>(total.totalAttempts) / total.games : 0.0;
+                std::cout << std::left << std::setw(10) << difficulty.name << std::setw(14) << thresholdText
+                          << std::setw(8) << strategy.name << std::right << std::fixed << std::setprecision(3)
+                          << std::setw(8) << mean << std::setw(6) << total.percentile(0.5)
+                          << std::setw(6) << total.percentile(0.9) << std::setw(6) << total.percentile(0.99)
+                          << std::setw(7) << total.maxAttempts << std::setw(12) << std::setprecision(0)
+                          << (seconds > 0 ? total.games / seconds : 0.0) << std::endl;
+
+                if (showHistogram) {
+                    for (std::size_t a = 1; a < kHistogramSize; a++) {
+                        if (total.histogram[a] > 0) {
+                            std::cout << "    " << std::setw(3) << a << (a == kHistogramSize - 1 ? "+" : " ")
+                                      << std::setw(10) << std::setprecision(4)
+                                      << 100.0 * total.histogram[a] / total.games << "%" << std::endl;
+                        }
+                    }
+                }
+            }
+
+            // What the best possible strategy would average, for reference
+            std::uint64_t span = distanceBetween(difficulty.range.min, difficulty.range.max);
+            if (!onlyStrategy && span <= kOptimalPlayMaxSpan) {
+                std::cout << std::left << std::setw(10) << difficulty.name << std::setw(14) << thresholdText
+                          << std::setw(8) << "optimal" << std::right << std::setprecision(3) << std::setw(8)
+                          << optimalExpectedAttempts(span, thresholds) << std::endl;
+            }
+        }
+    }
+    return 0;
+}
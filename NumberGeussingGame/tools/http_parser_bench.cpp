@@ -0,0 +1,232 @@
+// HTTP request parsing cost: in-place parser against the original one.
+//
+// The original parser (kept here as legacyParse, as it was before the
+// string_view rewrite) ran the request through std::istringstream and
+// copied every header into a std::unordered_map. parseHttpRequest() slices
+// the receive buffer in place. Each sample request is parsed many times by
+// both and the report gives ns/request and heap allocations per request.
+// The in-place parser works on a copy of the request, as the server's
+// receive buffer would be, and that copy is included in its time.
+//
+// Usage: HttpParserBench [--iterations N]
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+
+#include "../include/http_request.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+std::atomic<std::size_t> allocations(0);
+
+}
+
+// Count every heap allocation made while parsing
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LegacyRequest {
+    std::string method;
+    std::string path;
+    std::string body;
+    std::unordered_map<std::string, std::string> headers;
+    std::unordered_map<std::string, std::string> query_params;
+};
+
+LegacyRequest legacyParse(const std::string& requestStr) {
+    LegacyRequest request;
+    std::istringstream stream(requestStr);
+    std::string line;
+
+    if (std::getline(stream, line)) {
+        std::istringstream requestLine(line);
+        requestLine >> request.method;
+
+        std::string pathWithQuery;
+        requestLine >> pathWithQuery;
+
+        size_t queryPos = pathWithQuery.find('?');
+        if (queryPos != std::string::npos) {
+            request.path = pathWithQuery.substr(0, queryPos);
+
+            std::string queryString = pathWithQuery.substr(queryPos + 1);
+            std::istringstream queryStream(queryString);
+            std::string param;
+
+            while (std::getline(queryStream, param, '&')) {
+                size_t equalsPos = param.find('=');
+                if (equalsPos != std::string::npos) {
+                    std::string key = param.substr(0, equalsPos);
+                    std::string value = param.substr(equalsPos + 1);
+                    request.query_params[key] = value;
+                }
+            }
+        } else {
+            request.path = pathWithQuery;
+        }
+    }
+
+    while (std::getline(stream, line) && line != "\r") {
+        if (line.back() == '\r') {
+            line.pop_back();
+        }
+
+        size_t pos = line.find(':');
+        if (pos != std::string::npos) {
+            std::string key = line.substr(0, pos);
+            std::string value = line.substr(pos + 1);
+
+            while (!value.empty() && value.front() == ' ') {
+                value.erase(0, 1);
+            }
+
+            request.headers[key] = value;
+        }
+    }
+
+    if (request.headers.count("Content-Length") > 0) {
+        int contentLength = std::stoi(request.headers["Content-Length"]);
+
+        char* bodyBuffer = new char[contentLength + 1];
+        stream.read(bodyBuffer, contentLength);
+        bodyBuffer[contentLength] = '\0';
+        request.body = bodyBuffer;
+        delete[] bodyBuffer;
+    }
+    return request;
+}
+
+struct Sample {
+    const char* name;
+    std::string request;
+};
+
+const Sample kSamples[] = {
+    {"guess POST",
+     "POST /api/guess HTTP/1.1\r\n"
+     "Host: localhost:8081\r\n"
+     "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+     "Accept: */*\r\n"
+     "Accept-Language: en-US,en;q=0.5\r\n"
+     "Accept-Encoding: gzip, deflate, br\r\n"
+     "Content-Type: application/json\r\n"
+     "Content-Length: 40\r\n"
+     "Origin: http://localhost:8081\r\n"
+     "Connection: keep-alive\r\n"
+     "Referer: http://localhost:8081/\r\n"
+     "\r\n"
+     "{\"gameId\":\"0123456789abcdef\",\"guess\":42}"},
+    {"stats GET",
+     "GET /api/stats?user_id=42 HTTP/1.1\r\n"
+     "Host: localhost:8081\r\n"
+     "User-Agent: curl/8.5.0\r\n"
+     "Accept: application/json\r\n"
+     "\r\n"},
+    {"leaderboard GET",
+     "GET /api/leaderboard?limit=25&name=J%C3%BCrgen HTTP/1.1\r\n"
+     "Host: localhost:8081\r\n"
+     "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 14_5) AppleWebKit/605.1.15 Safari/605.1.15\r\n"
+     "Accept: application/msgpack\r\n"
+     "Accept-Language: de-DE,de;q=0.9\r\n"
+     "Accept-Encoding: gzip, deflate\r\n"
+     "Cookie: session=abcdef0123456789; theme=dark\r\n"
+     "Connection: keep-alive\r\n"
+     "\r\n"},
+};
+
+struct Result {
+    double nanos;
+    double allocationsPerRequest;
+};
+
+template <typename Parse>
+Result measure(std::size_t iterations, Parse parse) {
+    std::size_t before = allocations.load();
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < iterations; i++) {
+        parse();
+    }
+    Clock::time_point end = Clock::now();
+    double nanos = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    return {nanos, static_cast<double>(allocations.load() - before) / iterations};
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t iterations = 200000;
+    if (argc == 3 && std::strcmp(argv[1], "--iterations") == 0) {
+        iterations = std::strtoull(argv[2], nullptr, 10);
+    } else if (argc != 1) {
+        std::cerr << "Usage: HttpParserBench [--iterations N]" << std::endl;
+        return 1;
+    }
+    if (iterations == 0) {
+        std::cerr << "Iterations must be positive" << std::endl;
+        return 1;
+    }
+
+    HttpLimits limits;
+    char buffer[RequestBuffer::kInlineSize];
+    volatile std::size_t sink = 0;
+    int failures = 0;
+
+    std::cout << std::left << std::setw(18) << "request" << std::right << std::setw(8) << "bytes" << std::setw(14)
+              << "legacy ns" << std::setw(12) << "allocs" << std::setw(14) << "in-place ns" << std::setw(12)
+              << "allocs" << std::setw(10) << "speedup" << std::endl;
+    for (const Sample& sample : kSamples) {
+        // Both parsers must agree before their speed means anything
+        std::memcpy(buffer, sample.request.data(), sample.request.size());
+        HttpRequest check;
+        LegacyRequest reference = legacyParse(sample.request);
+        if (parseHttpRequest(buffer, sample.request.size(), check, limits) != ParseResult::Ok ||
+            check.method != reference.method || check.path != reference.path || check.body != reference.body) {
+            std::cerr << "Parsers disagree on " << sample.name << std::endl;
+            failures++;
+            continue;
+        }
+
+        Result legacy = measure(iterations, [&] {
+            LegacyRequest request = legacyParse(sample.request);
+            sink = sink + request.headers.size();
+        });
+        Result inPlace = measure(iterations, [&] {
+            std::memcpy(buffer, sample.request.data(), sample.request.size());
+            HttpRequest request;
+            parseHttpRequest(buffer, sample.request.size(), request, limits);
+            sink = sink + request.headers.size();
+        });
+
+        std::cout << std::left << std::setw(18) << sample.name << std::right << std::setw(8) << sample.request.size()
+                  << std::fixed << std::setprecision(1) << std::setw(14) << legacy.nanos << std::setw(12)
+                  << legacy.allocationsPerRequest << std::setw(14) << inPlace.nanos << std::setw(12)
+                  << inPlace.allocationsPerRequest << std::setw(9) << legacy.nanos / inPlace.nanos << "x"
+                  << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// JSON reading throughput: structural index against the direct reader.
+//
+// Builds large request-shaped documents (a top-level object whose members
+// hold arrays of game records, long strings or many small numbers) and
+// reads every top-level member of each one many times with
+//   direct     JsonReader over the bytes
+//   index      buildStructuralIndex() alone (stage 1)
+//   indexed    stage 1 plus JsonStructuralReader over the index
+// and reports GB/s of input for each. Both readers must accept each
+// document and return the same members before any timing is done.
+//
+// Usage: JsonThroughputBench [--size BYTES] [--iterations N]
+// Configure with -DCMAKE_BUILD_TYPE=Release (and -DENABLE_NATIVE_ARCH=ON
+// for AVX2) for meaningful numbers.
+
+#include "../include/json.h"
+#include "../include/json_structural.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::size_t size = 1 << 20;
+    std::size_t iterations = 200;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::size_t value = std::strtoull(argv[++i], nullptr, 10);
+        if (arg == "--size") {
+            options.size = value;
+        } else if (arg == "--iterations") {
+            options.iterations = value;
+        } else {
+            return false;
+        }
+    }
+    return options.size > 0 && options.iterations > 0;
+}
+
+struct Document {
+    const char* name;
+    std::string json;
+};
+
+// {"user_id":7,"games":[{"range_min":1,"range_max":100,"attempts":6,...},...]}
+std::string gameRecords(std::size_t size) {
+    std::string json = "{\"user_id\":7,\"games\":[";
+    for (int i = 0; json.size() < size; i++) {
+        if (i > 0) {
+            json += ',';
+        }
+        json += "{\"range_min\":1,\"range_max\":" + std::to_string(50 + i % 151) +
+                ",\"attempts\":" + std::to_string(1 + i % 9) + ",\"won\":" + (i % 3 ? "true" : "false") +
+                ",\"played_at\":\"2024-05-" + std::to_string(10 + i % 20) + "T12:34:56Z\",\"guesses\":[";
+        for (int g = 0; g < 1 + i % 9; g++) {
+            json += (g ? "," : "") + std::to_string(17 + g * 11);
+        }
+        json += "]}";
+    }
+    return json + "],\"source\":\"import\"}";
+}
+
+// Few members, most bytes inside strings (with the odd escape)
+std::string longStrings(std::size_t size) {
+    std::string json = "{\"user_id\":7";
+    for (int i = 0; json.size() < size; i++) {
+        json += ",\"note" + std::to_string(i) + "\":\"";
+        for (int c = 0; c < 4000; c++) {
+            json += c % 500 == 499 ? "\\\"" : std::string(1, static_cast<char>('a' + c % 26));
+        }
+        json += '"';
+    }
+    return json + "}";
+}
+
+// Nested arrays of small numbers: many structurals per byte
+std::string numberMatrix(std::size_t size) {
+    std::string json = "{\"user_id\":7,\"matrix\":[";
+    for (int row = 0; json.size() < size; row++) {
+        json += row ? ",[" : "[";
+        for (int c = 0; c < 32; c++) {
+            json += (c ? "," : "") + std::to_string((row * 31 + c * 7) % 1000);
+        }
+        json += ']';
+    }
+    return json + "]}";
+}
+
+// Touch every member the way a handler would: match the key, keep the view
+template <typename Reader>
+std::size_t readAll(Reader& reader) {
+    std::size_t members = 0;
+    JsonField field;
+    while (reader.next(field)) {
+        members += field.value.raw().size() + field.key.size();
+    }
+    return reader.ok() ? members : 0;
+}
+
+std::size_t readDirect(const std::string& json) {
+    JsonReader reader(json);
+    return readAll(reader);
+}
+
+std::size_t readIndexed(const std::string& json, std::vector<std::uint32_t>& index) {
+    if (!buildStructuralIndex(json, index)) {
+        return 0;
+    }
+    JsonStructuralReader reader(json, index);
+    return readAll(reader);
+}
+
+template <typename Read>
+double gigabytesPerSecond(std::size_t bytes, std::size_t iterations, Read read) {
+    volatile std::size_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < iterations; i++) {
+        sink = sink + read();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(bytes) * iterations / seconds / 1e9;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: JsonThroughputBench [--size BYTES] [--iterations N]" << std::endl;
+        return 1;
+    }
+
+    const Document documents[] = {
+        {"game records", gameRecords(options.size)},
+        {"long strings", longStrings(options.size)},
+        {"number matrix", numberMatrix(options.size)},
+    };
+
+    std::vector<std::uint32_t> index;
+    int failures = 0;
+    std::cout << std::left << std::setw(16) << "document" << std::right << std::setw(10) << "KiB" << std::setw(12)
+              << "direct" << std::setw(12) << "index" << std::setw(12) << "indexed" << std::setw(10) << "speedup"
+              << "   (GB/s)" << std::endl;
+    for (const Document& document : documents) {
+        const std::string& json = document.json;
+        std::size_t direct = readDirect(json);
+        if (direct == 0 || readIndexed(json, index) != direct) {
+            std::cerr << "Readers disagree on " << document.name << std::endl;
+            failures++;
+            continue;
+        }
+
+        double directRate = gigabytesPerSecond(json.size(), options.iterations, [&] { return readDirect(json); });
+        double indexRate = gigabytesPerSecond(json.size(), options.iterations, [&] {
+            buildStructuralIndex(json, index);
+            return index.size();
+        });
+        double indexedRate =
+            gigabytesPerSecond(json.size(), options.iterations, [&] { return readIndexed(json, index); });
+
+        std::cout << std::left << std::setw(16) << document.name << std::right << std::setw(10)
+                  << json.size() / 1024 << std::fixed << std::setprecision(2) << std::setw(12) << directRate
+                  << std::setw(12) << indexRate << std::setw(12) << indexedRate << std::setw(9)
+                  << indexedRate / directRate << "x" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
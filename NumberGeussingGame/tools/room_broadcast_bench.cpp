@@ -0,0 +1,151 @@
+// Broadcast latency of a multiplayer room.
+//
+// Joins N members to one GameRoom over Unix socket pairs, publishes events
+// of a given payload size and reports, per event, how long publish() took
+// (frame once, write to every member) and how long until the last member
+// had read the whole frame. Every member's copy is checked for the expected
+// sequence number, so lost or reordered events show up as errors.
+//
+// Usage: RoomBroadcastBench [--members N] [--events N] [--payload BYTES]
+
+#include "../include/game_rooms.h"
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::size_t members = 1000;
+    std::size_t events = 2000;
+    std::size_t payload = 96;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::size_t value = std::strtoull(argv[++i], nullptr, 10);
+        if (arg == "--members") {
+            options.members = value;
+        } else if (arg == "--events") {
+            options.events = value;
+        } else if (arg == "--payload") {
+            options.payload = value;
+        } else {
+            return false;
+        }
+    }
+    return options.members > 0 && options.members <= GameRoom::kMaxMembers && options.events > 0;
+}
+
+// Two descriptors per member, plus a few for the process itself
+bool raiseDescriptorLimit(std::size_t needed) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return false;
+    }
+    if (limit.rlim_cur >= needed) {
+        return true;
+    }
+    limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, needed);
+    return setrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur >= needed;
+}
+
+double percentile(std::vector<double>& samples, double fraction) {
+    std::size_t index = static_cast<std::size_t>(fraction * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+void printRow(const char* name, std::vector<double>& samples, std::size_t members) {
+    double p50 = percentile(samples, 0.50);
+    double p90 = percentile(samples, 0.90);
+    double p99 = percentile(samples, 0.99);
+    double max = *std::max_element(samples.begin(), samples.end());
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << p50 << std::setw(10) << p90 << std::setw(10) << p99 << std::setw(10) << max
+              << std::setw(14) << p50 * 1000.0 / members << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: RoomBroadcastBench [--members N (at most " << GameRoom::kMaxMembers
+                  << ")] [--events N] [--payload BYTES]" << std::endl;
+        return 1;
+    }
+    if (!raiseDescriptorLimit(options.members * 2 + 16)) {
+        std::cerr << "Not enough file descriptors for " << options.members << " members" << std::endl;
+        return 1;
+    }
+
+    GameRoom room(1, kMediumRange);
+    std::vector<int> readers;
+    readers.reserve(options.members);
+    for (std::size_t i = 0; i < options.members; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            std::cerr << "socketpair failed: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        room.join(pair[0], static_cast<int>(i));
+        readers.push_back(pair[1]);
+    }
+
+    const std::string data(options.payload, 'x');
+    std::vector<char> received(options.payload + 64);
+    std::vector<double> publishMicros;
+    std::vector<double> deliveryMicros;
+    publishMicros.reserve(options.events);
+    deliveryMicros.reserve(options.events);
+    std::size_t errors = 0;
+
+    for (std::size_t event = 0; event < options.events; event++) {
+        Clock::time_point start = Clock::now();
+        std::uint64_t sequence = room.publish("guess", data);
+        Clock::time_point published = Clock::now();
+
+        // Publish wrote every frame before returning, so each read is immediate
+        std::string prefix = "id: " + std::to_string(sequence) + "\n";
+        std::size_t frameSize = prefix.size() + std::strlen("event: guess\ndata: ") + data.size() + 2;
+        for (int reader : readers) {
+            ssize_t n = recv(reader, received.data(), received.size(), MSG_DONTWAIT);
+            if (n != static_cast<ssize_t>(frameSize) ||
+                std::memcmp(received.data(), prefix.data(), prefix.size()) != 0) {
+                errors++;
+            }
+        }
+        Clock::time_point delivered = Clock::now();
+
+        publishMicros.push_back(std::chrono::duration<double, std::micro>(published - start).count());
+        deliveryMicros.push_back(std::chrono::duration<double, std::micro>(delivered - start).count());
+    }
+
+    std::cout << "Room broadcast: " << options.members << " members, " << options.events << " events, "
+              << options.payload << " byte payload" << std::endl;
+    std::cout << std::left << std::setw(10) << "us" << std::right << std::setw(10) << "p50" << std::setw(10)
+              << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << std::setw(14) << "ns/member"
+              << std::endl;
+    printRow("publish", publishMicros, options.members);
+    printRow("delivery", deliveryMicros, options.members);
+    std::cout << "Members still joined: " << room.memberCount() << ", delivery errors: " << errors << std::endl;
+
+    for (int reader : readers) {
+        close(reader);
+    }
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+// Round-trip latency of small exchanges under each socket profile.
+//
+// A server thread applies the profile to its listener and connections, as
+// the game server does, and answers a small request with a response
+// written in two parts (head, then body). Two patterns are timed from the
+// client side over loopback:
+//   fresh       connect, request, response, close (one exchange per connection)
+//   keep-alive  request/response ping-pong on one connection, where Nagle
+//               and delayed ACKs interact on the second write
+// The "default" profile turns every option off; the other one is
+// SocketProfile::fromEnvironment(), so NGG_* variables can be compared.
+//
+// Usage: SocketLatencyBench [--exchanges N] [--keepalive-exchanges N]
+
+#include "../include/socket_profile.h"
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char kRequest[] = "POST /api/guess HTTP/1.1\r\nContent-Length: 40\r\n\r\n{\"gameId\":\"0123456789abcdef\",\"guess\":42}";
+const char kHead[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 63\r\n\r\n";
+const char kBody[] = "{\"success\":true,\"attempts\":3,\"message\":\"Warm.\",\"correct\":false}";
+constexpr std::size_t kRequestSize = sizeof(kRequest) - 1;
+constexpr std::size_t kResponseSize = sizeof(kHead) - 1 + sizeof(kBody) - 1;
+
+bool readExactly(int fd, std::size_t size) {
+    char buffer[512];
+    std::size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, buffer, std::min(sizeof(buffer), size - received), 0);
+        if (n <= 0) {
+            return false;
+        }
+        received += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool respond(int fd) {
+    return send(fd, kHead, sizeof(kHead) - 1, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(kHead) - 1) &&
+           send(fd, kBody, sizeof(kBody) - 1, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(kBody) - 1);
+}
+
+int listenOnLoopback(const SocketProfile& profile, int& port) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (listener < 0 || bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0 ||
+        getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &length) != 0) {
+        std::cerr << "Failed to listen on loopback: " << std::strerror(errno) << std::endl;
+        std::exit(1);
+    }
+    profile.applyToListener(listener);
+    port = ntohs(address.sin_port);
+    return listener;
+}
+
+int connectTo(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Failed to connect: " << std::strerror(errno) << std::endl;
+        std::exit(1);
+    }
+    return fd;
+}
+
+double micros(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// One connection per exchange, closed by the server like the game server does
+std::vector<double> runFresh(const SocketProfile& profile, std::size_t exchanges) {
+    int port = 0;
+    int listener = listenOnLoopback(profile, port);
+    std::thread server([&] {
+        for (std::size_t i = 0; i < exchanges; i++) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            profile.applyToClient(client);
+            if (readExactly(client, kRequestSize)) {
+                respond(client);
+            }
+            close(client);
+        }
+    });
+
+    std::vector<double> samples;
+    samples.reserve(exchanges);
+    for (std::size_t i = 0; i < exchanges; i++) {
+        Clock::time_point start = Clock::now();
+        int fd = connectTo(port);
+        send(fd, kRequest, kRequestSize, MSG_NOSIGNAL);
+        readExactly(fd, kResponseSize);
+        samples.push_back(micros(start, Clock::now()));
+        close(fd);
+    }
+    server.join();
+    close(listener);
+    return samples;
+}
+
+// Request/response pairs on one connection
+std::vector<double> runKeepAlive(const SocketProfile& profile, std::size_t exchanges) {
+    int port = 0;
+    int listener = listenOnLoopback(profile, port);
+    std::thread server([&] {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            return;
+        }
+        profile.applyToClient(client);
+        for (std::size_t i = 0; i < exchanges; i++) {
+            if (!readExactly(client, kRequestSize) || !respond(client)) {
+                break;
+            }
+            // QUICKACK is not sticky on Linux; re-arm it as the server does per connection
+            profile.applyToClient(client);
+        }
+        close(client);
+    });
+
+    std::vector<double> samples;
+    samples.reserve(exchanges);
+    int fd = connectTo(port);
+    for (std::size_t i = 0; i < exchanges; i++) {
+        Clock::time_point start = Clock::now();
+        send(fd, kRequest, kRequestSize, MSG_NOSIGNAL);
+        readExactly(fd, kResponseSize);
+        samples.push_back(micros(start, Clock::now()));
+    }
+    close(fd);
+    server.join();
+    close(listener);
+    return samples;
+}
+
+double percentile(std::vector<double> samples, double fraction) {
+    std::size_t index = static_cast<std::size_t>(fraction * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+void printRow(const char* profile, const char* pattern, const std::vector<double>& samples) {
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    std::cout << std::left << std::setw(13) << profile << std::setw(12) << pattern << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << percentile(samples, 0.50) << std::setw(10)
+              << percentile(samples, 0.99) << std::setw(10) << total / samples.size() << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t exchanges = 2000;
+    std::size_t keepAliveExchanges = 200;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::size_t value = std::strtoull(argv[i + 1], nullptr, 10);
+        if (arg == "--exchanges") {
+            exchanges = value;
+        } else if (arg == "--keepalive-exchanges") {
+            keepAliveExchanges = value;
+        } else {
+            std::cerr << "Usage: SocketLatencyBench [--exchanges N] [--keepalive-exchanges N]" << std::endl;
+            return 1;
+        }
+    }
+    if (exchanges == 0 || keepAliveExchanges == 0) {
+        std::cerr << "Exchange counts must be positive" << std::endl;
+        return 1;
+    }
+
+    SocketProfile plain;
+    plain.name = "default";
+    plain.noDelay = false;
+    plain.quickAck = false;
+    plain.deferAcceptSeconds = 0;
+    plain.fastOpenQueue = 0;
+    plain.busyPollMicros = 0;
+    SocketProfile tuned = SocketProfile::fromEnvironment();
+    tuned.report(std::cout);
+
+    std::cout << std::left << std::setw(13) << "profile" << std::setw(12) << "pattern" << std::right
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "mean us" << std::endl;
+    for (const SocketProfile* profile : {&plain, &tuned}) {
+        printRow(profile->name, "fresh", runFresh(*profile, exchanges));
+        printRow(profile->name, "keep-alive", runKeepAlive(*profile, keepAliveExchanges));
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+// Hot upgrade under load.
+//
+// Starts the server, keeps several clients sending requests back to back
+// and sends SIGUSR2 a few times while they run. Every request must get a
+// 200 and every upgrade must end with a new process serving, so a dropped
+// connection or a refused connect during the handoff fails the run.
+//
+// Usage: UpgradeLoadTest [--server PATH] [--port N] [--clients N]
+//                        [--upgrades N] [--interval-ms N]
+//
+// Run it from the build directory: the server is started there, reads
+// public/ and uses the database file there. Its output goes to
+// upgrade_load_test.log, which is also where the new process IDs are read.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const kLogFile = "upgrade_load_test.log";
+
+struct Options {
+    std::string server = "./NumberGuessingGame";
+    int port = 8081;
+    int clients = 8;
+    int upgrades = 3;
+    int intervalMs = 1500;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--server") {
+            options.server = value;
+        } else if (arg == "--port") {
+            options.port = std::atoi(value.c_str());
+        } else if (arg == "--clients") {
+            options.clients = std::atoi(value.c_str());
+        } else if (arg == "--upgrades") {
+            options.upgrades = std::atoi(value.c_str());
+        } else if (arg == "--interval-ms") {
+            options.intervalMs = std::atoi(value.c_str());
+        } else {
+            return false;
+        }
+    }
+    return options.port > 0 && options.clients > 0 && options.upgrades >= 0 && options.intervalMs > 0;
+}
+
+int connectTo(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One request on its own connection; true for a complete 200 response
+bool requestOnce(int port) {
+    int fd = connectTo(port);
+    if (fd < 0) {
+        return false;
+    }
+    static const char request[] = "GET /api/stats HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    bool sent = send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(request) - 1);
+
+    std::string response;
+    char buffer[4096];
+    ssize_t n;
+    while (sent && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, static_cast<std::size_t>(n));
+    }
+    close(fd);
+    return response.compare(0, 12, "HTTP/1.1 200") == 0 && response.find("\r\n\r\n") != std::string::npos;
+}
+
+bool waitUntilServing(int port, int timeoutMs) {
+    for (int waited = 0; waited < timeoutMs; waited += 50) {
+        int fd = connectTo(port);
+        if (fd >= 0) {
+            close(fd);
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+bool processAlive(pid_t pid) {
+    return kill(pid, 0) == 0;
+}
+
+// Pid of the last process started by an upgrade, from the shared log
+pid_t lastUpgradedPid() {
+    std::ifstream log(kLogFile);
+    std::string line;
+    pid_t pid = -1;
+    const std::string marker = "(pid ";
+    while (std::getline(log, line)) {
+        std::size_t at = line.find(marker);
+        if (line.find("Started new binary") != std::string::npos && at != std::string::npos) {
+            pid = static_cast<pid_t>(std::atoi(line.c_str() + at + marker.size()));
+        }
+    }
+    return pid;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: UpgradeLoadTest [--server PATH] [--port N] [--clients N] [--upgrades N] [--interval-ms N]"
+                  << std::endl;
+        return 1;
+    }
+
+    pid_t server = fork();
+    if (server < 0) {
+        std::cerr << "fork failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    if (server == 0) {
+        // Appending, so every process in the upgrade chain shares one log
+        int log = open(kLogFile, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (log >= 0) {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+            close(log);
+        }
+        execl(options.server.c_str(), options.server.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    // A server that exited (say, port in use) must not be mistaken for another one answering
+    if (!waitUntilServing(options.port, 10000) || waitpid(server, nullptr, WNOHANG) != 0) {
+        std::cerr << "Server did not start listening on port " << options.port << ", see " << kLogFile
+                  << std::endl;
+        kill(server, SIGTERM);
+        return 1;
+    }
+
+    std::atomic<bool> running(true);
+    std::atomic<long> succeeded(0);
+    std::atomic<long> failed(0);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < options.clients; i++) {
+        clients.emplace_back([&] {
+            while (running.load()) {
+                if (requestOnce(options.port)) {
+                    succeeded++;
+                } else {
+                    failed++;
+                }
+            }
+        });
+    }
+
+    // The first process is our child; later ones are found through the log
+    pid_t current = server;
+    int completed = 0;
+    for (int upgrade = 0; upgrade < options.upgrades; upgrade++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(options.intervalMs));
+        pid_t previous = current;
+        kill(previous, SIGUSR2);
+
+        for (int waited = 0; waited < 15000 && processAlive(previous); waited += 20) {
+            if (previous == server) {
+                waitpid(server, nullptr, WNOHANG);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        pid_t next = lastUpgradedPid();
+        if (processAlive(previous) || next <= 0 || next == previous || !processAlive(next)) {
+            std::cerr << "Upgrade " << upgrade + 1 << " did not complete" << std::endl;
+            break;
+        }
+        current = next;
+        completed++;
+        std::cout << "Upgrade " << completed << ": pid " << previous << " -> " << current
+                  << ", requests so far " << succeeded.load() << " ok, " << failed.load() << " failed" << std::endl;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.intervalMs));
+    running = false;
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    kill(current, SIGTERM);
+    if (current == server) {
+        waitpid(server, nullptr, 0);
+    }
+
+    std::cout << "Upgrades completed: " << completed << " of " << options.upgrades << std::endl;
+    std::cout << "Requests: " << succeeded.load() << " ok, " << failed.load() << " failed" << std::endl;
+    return completed == options.upgrades && failed.load() == 0 && succeeded.load() > 0 ? 0 : 1;
+}
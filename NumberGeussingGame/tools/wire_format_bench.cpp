@@ -0,0 +1,192 @@
+// Encode/decode cost and payload size of the API's wire formats.
+//
+// Responses the server sends (/api/guess, /api/stats and a 25-row
+// /api/leaderboard) are encoded through ObjectBuilder/ArrayBuilder in JSON,
+// MessagePack and CBOR, as the handlers do. Request bodies the server reads
+// (/api/guess, /api/new-game, /api/login) are decoded with the matching
+// reader, visiting every member and converting its value. The report gives
+// ns per payload and its size in bytes for each format.
+//
+// Usage: WireFormatBench [--iterations N]
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+
+#include "../include/cbor.h"
+#include "../include/json.h"
+#include "../include/msgpack.h"
+#include "../include/wire_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const WireFormat kFormats[] = {WireFormat::Json, WireFormat::MessagePack, WireFormat::Cbor};
+
+void encodeGuess(std::string& out, WireFormat format) {
+    ObjectBuilder(out, format)
+        .add("success", true)
+        .add("attempts", 6)
+        .add("optimalAttempts", 5.8)
+        .add("efficiency", 0.97)
+        .add("message", "Correct!")
+        .add("correct", true)
+        .build();
+}
+
+void encodeStats(std::string& out, WireFormat format) {
+    ObjectBuilder(out, format)
+        .add("totalGames", 57)
+        .add("wins", 27)
+        .add("bestScore", 3)
+        .add("avgAttempts", 6.0701754385964914)
+        .build();
+}
+
+void encodeLeaderboard(std::string& out, WireFormat format) {
+    const std::uint32_t rows = 25;
+    ArrayBuilder array(out, format, rows);
+    for (std::uint32_t i = 0; i < rows; i++) {
+        array.item();
+        ObjectBuilder(out, format)
+            .add("username", "player" + std::to_string(1000 + i * 37))
+            .add("best_score", static_cast<int>(2 + i / 5))
+            .add("games_played", static_cast<int>(40 - i))
+            .add("wins", static_cast<int>(30 - i))
+            .build();
+    }
+    array.build();
+}
+
+struct Response {
+    const char* name;
+    void (*encode)(std::string&, WireFormat);
+};
+
+const Response kResponses[] = {
+    {"guess response", encodeGuess},
+    {"stats response", encodeStats},
+    {"leaderboard x25", encodeLeaderboard},
+};
+
+struct Request {
+    const char* name;
+    std::function<void(ObjectBuilder&)> fill;
+};
+
+const Request kRequests[] = {
+    {"guess request", [](ObjectBuilder& body) { body.add("gameId", "0123456789abcdef").add("guess", 42); }},
+    {"new-game request",
+     [](ObjectBuilder& body) {
+         body.add("user_id", 3027).add("difficulty", "custom").add("min", 1).add("max", 1000000);
+     }},
+    {"login request",
+     [](ObjectBuilder& body) { body.add("username", "player1037").add("password", "correct horse battery"); }},
+};
+
+// Visit every member and convert its value, as request binding would
+template <typename Reader>
+std::size_t readAll(std::string_view data) {
+    Reader reader(data);
+    JsonField field;
+    std::size_t touched = 0;
+    std::int64_t number;
+    while (reader.next(field)) {
+        if (field.value.type() == JsonType::String) {
+            touched += field.value.equals("custom");
+        } else if (field.value.asInt64(number)) {
+            touched += static_cast<std::size_t>(number);
+        }
+        touched += field.keyEquals("guess");
+    }
+    return reader.ok() ? touched + 1 : 0;
+}
+
+std::size_t decode(WireFormat format, std::string_view data) {
+    switch (format) {
+        case WireFormat::MessagePack: return readAll<MsgPackReader>(data);
+        case WireFormat::Cbor: return readAll<CborReader>(data);
+        default: return readAll<JsonReader>(data);
+    }
+}
+
+template <typename Run>
+double nanosPerRun(std::size_t iterations, Run run) {
+    volatile std::size_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < iterations; i++) {
+        sink = sink + run();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+void printHeader(const char* operation) {
+    std::cout << std::left << std::setw(18) << operation << std::right;
+    for (const char* name : {"json", "msgpack", "cbor"}) {
+        std::cout << std::setw(12) << (std::string(name) + " ns") << std::setw(8) << "bytes";
+    }
+    std::cout << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t iterations = 1000000;
+    if (argc == 3 && std::strcmp(argv[1], "--iterations") == 0) {
+        iterations = std::strtoull(argv[2], nullptr, 10);
+    } else if (argc != 1) {
+        std::cerr << "Usage: WireFormatBench [--iterations N]" << std::endl;
+        return 1;
+    }
+    if (iterations == 0) {
+        std::cerr << "Iterations must be positive" << std::endl;
+        return 1;
+    }
+
+    // Reused between payloads, as the server reuses its response buffer
+    std::string out;
+    out.reserve(4096);
+    int failures = 0;
+
+    printHeader("encode");
+    for (const Response& response : kResponses) {
+        std::cout << std::left << std::setw(18) << response.name << std::right << std::fixed << std::setprecision(1);
+        for (WireFormat format : kFormats) {
+            // Responses are bigger; a tenth of the runs is plenty
+            double nanos = nanosPerRun(std::max<std::size_t>(1, iterations / 10), [&] {
+                out.clear();
+                response.encode(out, format);
+                return out.size();
+            });
+            std::cout << std::setw(12) << nanos << std::setw(8) << out.size();
+        }
+        std::cout << std::endl;
+    }
+
+    printHeader("decode");
+    for (const Request& request : kRequests) {
+        std::cout << std::left << std::setw(18) << request.name << std::right << std::fixed << std::setprecision(1);
+        for (WireFormat format : kFormats) {
+            std::string body;
+            ObjectBuilder builder(body, format);
+            request.fill(builder);
+            builder.build();
+            if (decode(format, body) == 0) {
+                std::cerr << std::endl << "Reader rejected the " << request.name << std::endl;
+                failures++;
+                break;
+            }
+            double nanos = nanosPerRun(iterations, [&] { return decode(format, body); });
+            std::cout << std::setw(12) << nanos << std::setw(8) << body.size();
+        }
+        std::cout << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}